@@ -0,0 +1,158 @@
+// scheduler_c.cpp: C ABI over the native Scheduler (see scheduler_c.h)
+#include "scheduler_c.h"
+#include "scheduler.h"
+#include "problem_buffer.h"
+#include "problem_snapshot.h"
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+
+struct sched_problem {
+    Scheduler scheduler;
+    uint64_t sourceHash = 0;
+};
+
+namespace {
+
+thread_local std::string lastError;
+
+int fail(int code, const std::string& message) {
+    lastError = message;
+    return code;
+}
+
+int solveConfigs(sched_problem* problem, const std::vector<Config>& configs, uint8_t** out, size_t* out_size) {
+    std::vector<uint8_t> bytes = encodeResults(problem->scheduler.solveScenarios(configs));
+
+    // Handed over to C callers, so it must be released with free() in sched_buffer_free
+    uint8_t* buffer = (uint8_t*)std::malloc(bytes.empty() ? 1 : bytes.size());
+    if (!buffer) return fail(SCHED_ERR_INTERNAL, "out of memory");
+    if (!bytes.empty()) std::memcpy(buffer, bytes.data(), bytes.size());
+    *out = buffer;
+    *out_size = bytes.size();
+    return SCHED_OK;
+}
+
+} // namespace
+
+extern "C" {
+
+SCHED_API uint32_t sched_abi_version(void) {
+    return SCHED_ABI_VERSION;
+}
+
+SCHED_API const char* sched_last_error(void) {
+    return lastError.c_str();
+}
+
+SCHED_API int sched_problem_create(const uint8_t* data, size_t size, sched_problem** out) {
+    if (!data || !out) return fail(SCHED_ERR_ARGUMENT, "data and out must not be NULL");
+    *out = nullptr;
+    try {
+        Problem problem;
+        std::string error;
+        if (!decodeProblem(data, size, problem, error)) return fail(SCHED_ERR_FORMAT, error);
+
+        sched_problem* handle = new sched_problem();
+        handle->scheduler.loadData(problem, Config());
+        handle->sourceHash = hashProblemBuffer(data, size);
+        *out = handle;
+        return SCHED_OK;
+    } catch (const std::exception& e) {
+        return fail(SCHED_ERR_INTERNAL, e.what());
+    } catch (...) {
+        return fail(SCHED_ERR_INTERNAL, "unknown error");
+    }
+}
+
+SCHED_API void sched_problem_free(sched_problem* problem) {
+    delete problem;
+}
+
+SCHED_API int sched_problem_save_snapshot(const sched_problem* problem, const char* path) {
+    if (!problem || !path) return fail(SCHED_ERR_ARGUMENT, "problem and path must not be NULL");
+    try {
+        std::string error;
+        if (!problem->scheduler.saveSnapshot(path, problem->sourceHash, error)) return fail(SCHED_ERR_IO, error);
+        return SCHED_OK;
+    } catch (const std::exception& e) {
+        return fail(SCHED_ERR_INTERNAL, e.what());
+    } catch (...) {
+        return fail(SCHED_ERR_INTERNAL, "unknown error");
+    }
+}
+
+SCHED_API int sched_problem_save_snapshot_rules(const sched_problem* problem, const char* path,
+                                                const uint8_t* config, size_t config_size) {
+    if (!problem || !path || !config) return fail(SCHED_ERR_ARGUMENT, "problem, path and config must not be NULL");
+    try {
+        Config decoded;
+        std::string error;
+        if (!decodeConfig(config, config_size, decoded, error)) return fail(SCHED_ERR_FORMAT, error);
+        if (!problem->scheduler.saveSnapshot(path, problem->sourceHash, decoded, error)) return fail(SCHED_ERR_IO, error);
+        return SCHED_OK;
+    } catch (const std::exception& e) {
+        return fail(SCHED_ERR_INTERNAL, e.what());
+    } catch (...) {
+        return fail(SCHED_ERR_INTERNAL, "unknown error");
+    }
+}
+
+SCHED_API int sched_problem_open_snapshot(const char* path, const uint8_t* data, size_t size,
+                                          sched_problem** out) {
+    if (!path || !data || !out) return fail(SCHED_ERR_ARGUMENT, "path, data and out must not be NULL");
+    *out = nullptr;
+    try {
+        sched_problem* handle = new sched_problem();
+        handle->sourceHash = hashProblemBuffer(data, size);
+        std::string error;
+        if (!handle->scheduler.loadSnapshot(path, handle->sourceHash, Config(), error)) {
+            delete handle;
+            return fail(SCHED_ERR_FORMAT, error);
+        }
+        *out = handle;
+        return SCHED_OK;
+    } catch (const std::exception& e) {
+        return fail(SCHED_ERR_INTERNAL, e.what());
+    } catch (...) {
+        return fail(SCHED_ERR_INTERNAL, "unknown error");
+    }
+}
+
+SCHED_API int sched_solve(sched_problem* problem, const uint8_t* config, size_t config_size,
+                          uint8_t** out, size_t* out_size) {
+    return sched_solve_batch(problem, &config, &config_size, 1, out, out_size);
+}
+
+SCHED_API int sched_solve_batch(sched_problem* problem, const uint8_t* const* configs,
+                                const size_t* config_sizes, size_t count,
+                                uint8_t** out, size_t* out_size) {
+    if (!problem || !configs || !config_sizes || !out || !out_size) {
+        return fail(SCHED_ERR_ARGUMENT, "problem, configs, config_sizes, out and out_size must not be NULL");
+    }
+    *out = nullptr;
+    *out_size = 0;
+    try {
+        std::vector<Config> scenarios(count);
+        for (size_t i = 0; i < count; ++i) {
+            if (!configs[i]) return fail(SCHED_ERR_ARGUMENT, "config " + std::to_string(i) + " is NULL");
+            std::string error;
+            if (!decodeConfig(configs[i], config_sizes[i], scenarios[i], error)) {
+                return fail(SCHED_ERR_FORMAT, "config " + std::to_string(i) + ": " + error);
+            }
+        }
+        return solveConfigs(problem, scenarios, out, out_size);
+    } catch (const std::exception& e) {
+        return fail(SCHED_ERR_INTERNAL, e.what());
+    } catch (...) {
+        return fail(SCHED_ERR_INTERNAL, "unknown error");
+    }
+}
+
+SCHED_API void sched_buffer_free(uint8_t* buffer) {
+    std::free(buffer);
+}
+
+} // extern "C"
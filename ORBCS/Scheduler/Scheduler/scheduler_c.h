@@ -0,0 +1,81 @@
+/* scheduler_c.h: stable C ABI of the native scheduler for non-Node consumers.
+ *
+ * Problems, configs and results travel as binary buffers in the format described in
+ * native/problem_buffer.h. A problem is decoded and indexed once when its handle is
+ * created and can then be solved any number of times with different configs.
+ *
+ * All functions return SCHED_OK on success; on failure sched_last_error() describes
+ * the error of the last failed call on the calling thread. Calls on one problem handle
+ * must not overlap; different handles are independent.
+ */
+#ifndef SCHEDULER_C_H
+#define SCHEDULER_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  ifdef SCHEDULER_EXPORTS
+#    define SCHED_API __declspec(dllexport)
+#  else
+#    define SCHED_API __declspec(dllimport)
+#  endif
+#else
+#  define SCHED_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCHED_ABI_VERSION 1
+
+enum {
+    SCHED_OK = 0,
+    SCHED_ERR_ARGUMENT = 1, /* NULL handle/pointer or empty input */
+    SCHED_ERR_FORMAT = 2,   /* malformed or unsupported buffer */
+    SCHED_ERR_INTERNAL = 3, /* unexpected failure inside the solver */
+    SCHED_ERR_IO = 4        /* snapshot file cannot be written */
+};
+
+typedef struct sched_problem sched_problem;
+
+SCHED_API uint32_t sched_abi_version(void);
+SCHED_API const char* sched_last_error(void);
+
+/* Decodes and indexes a problem buffer. The handle owns a copy of the data. */
+SCHED_API int sched_problem_create(const uint8_t* data, size_t size, sched_problem** out);
+SCHED_API void sched_problem_free(sched_problem* problem);
+
+/* Saves the indexed problem as a precompiled snapshot file (native/problem_snapshot.h). */
+SCHED_API int sched_problem_save_snapshot(const sched_problem* problem, const char* path);
+/* The same, and keeps the scheduling rules of a config buffer compiled in the snapshot:
+ * solving the opened snapshot with the same rules and strictness skips compiling them. */
+SCHED_API int sched_problem_save_snapshot_rules(const sched_problem* problem, const char* path,
+                                                const uint8_t* config, size_t config_size);
+
+/* Loads a problem from a snapshot: the indexed tables are read from the mapped file instead
+ * of being rebuilt from the source data. `data` is the source problem buffer; it is only
+ * hashed, and a snapshot of different data is rejected with SCHED_ERR_FORMAT. */
+SCHED_API int sched_problem_open_snapshot(const char* path, const uint8_t* data, size_t size,
+                                          sched_problem** out);
+
+/* Solves the problem with one config buffer. On success *out holds a result buffer
+ * with a single scenario; release it with sched_buffer_free(). A config with non-finite
+ * or out-of-range values or unsupported rules fails with SCHED_ERR_FORMAT. */
+SCHED_API int sched_solve(sched_problem* problem, const uint8_t* config, size_t config_size,
+                          uint8_t** out, size_t* out_size);
+
+/* Solves `count` configs concurrently on the shared index; the result buffer holds
+ * one scenario per config, in order. */
+SCHED_API int sched_solve_batch(sched_problem* problem, const uint8_t* const* configs,
+                                const size_t* config_sizes, size_t count,
+                                uint8_t** out, size_t* out_size);
+
+SCHED_API void sched_buffer_free(uint8_t* buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCHEDULER_C_H */
@@ -0,0 +1,11 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+// Global operator new/delete are replaced in alloc_counter.cpp; every form is a counted
+// malloc paired with free. They live in their own translation unit so the compiler never
+// inlines a replaced delete into code that it sees calling the library's operator new.
+
+// Allocations through any global operator new since start
+long long allocationCount();
+
+#endif // ALLOC_COUNTER_H
@@ -0,0 +1,88 @@
+# -*- coding: utf-8 -*-
+"""Сравнивает отчёт scheduler_bench с сохранённым базовым отчётом.
+
+Базовый отчёт снимается на той же машине: абсолютные ns/op разных машин несравнимы.
+С --init отсутствующий базовый отчёт создаётся из текущего, и проверка проходит.
+
+Завершается с кодом 1, если ns/op или allocs/op какого-либо ядра выросли больше,
+чем на заданный процент, или ядро из базового отчёта пропало из текущего
+(переименованное или удалённое ядро требует переснять базу). Новые ядра только выводятся.
+
+Запуск: python compare_bench.py baseline.json current.json [--threshold 25] [--init]
+"""
+import argparse
+import json
+import os
+import shutil
+import sys
+
+METRICS = ('nsPerOp', 'allocsPerOp')
+
+
+def load(path):
+    with open(path, encoding='utf-8') as f:
+        report = json.load(f)
+    return {(b['kernel'], b['entries']): b for b in report['benchmarks']}
+
+
+def regression(old, new):
+    """Рост метрики в процентах (0 для нулевой базы без изменений)."""
+    if old == 0:
+        return 0.0 if new == 0 else float('inf')
+    return (new - old) / old * 100.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('baseline')
+    parser.add_argument('current')
+    parser.add_argument('--threshold', type=float, default=25.0,
+                        help='допустимый рост метрики, %% (по умолчанию 25)')
+    parser.add_argument('--init', action='store_true',
+                        help='создать базовый отчёт из текущего, если его ещё нет')
+    args = parser.parse_args()
+
+    if not os.path.exists(args.baseline):
+        if not args.init:
+            print('Нет базового отчёта %s: снимите его целью bench_baseline '
+                  '(или запустите с --init)' % args.baseline)
+            return 2
+        shutil.copyfile(args.current, args.baseline)
+        print('Базовый отчёт создан: %s' % args.baseline)
+        return 0
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+    failures = []
+    print('%-14s %7s %14s %14s %8s %10s %10s' % ('kernel', 'entries', 'base ns/op', 'ns/op', 'Δ%',
+                                               'base alloc', 'alloc'))
+    for key in sorted(current, key=lambda k: (k[1], k[0])):
+        cur = current[key]
+        base = baseline.get(key)
+        if base is None:
+            print('%-14s %7d %14s %14.1f %8s %10s %10.1f  (нет в базе)' % (
+                key[0], key[1], '-', cur['nsPerOp'], '-', '-', cur['allocsPerOp']))
+            continue
+        print('%-14s %7d %14.1f %14.1f %+7.1f%% %10.1f %10.1f' % (
+            key[0], key[1], base['nsPerOp'], cur['nsPerOp'], regression(base['nsPerOp'], cur['nsPerOp']),
+            base['allocsPerOp'], cur['allocsPerOp']))
+        for metric in METRICS:
+            growth = regression(base[metric], cur[metric])
+            if growth > args.threshold:
+                failures.append('%s/%d: %s %.1f -> %.1f (+%.1f%%)' % (
+                    key[0], key[1], metric, base[metric], cur[metric], growth))
+
+    for key in sorted(set(baseline) - set(current)):
+        failures.append('%s/%d: нет в текущем отчёте' % key)
+
+    if failures:
+        print('\nРегрессии больше %.1f%% или пропавшие ядра:' % args.threshold)
+        for line in failures:
+            print('  ' + line)
+        return 1
+    print('\nРегрессий больше %.1f%% нет' % args.threshold)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,331 @@
+// Micro-benchmarks for the native scheduler kernels.
+//
+// Times calculateCost, the greedy conflict scan (placeEntry), one simulated annealing step,
+// indexify (loadData), loading a precompiled snapshot and buffer parsing on fixed seeded
+// instances, and prints JSON:
+//   { "version": 1, "benchmarks": [ { "kernel", "entries", "ops", "nsPerOp", "allocsPerOp",
+//                                     "movesPerSec" }, ... ] }
+// compare_bench.py checks such a report against a baseline recorded on the same machine.
+//
+// Usage: scheduler_bench [--sizes 100,1000,10000] [--min-time 0.1] [--repetitions 3] [--out report.json]
+//                        [--work-dir dir]
+// The snapshot kernel writes its file under --work-dir (the system temp directory by default)
+// and removes it afterwards.
+
+#include "scheduler.h"
+#include "problem_buffer.h"
+#include "problem_snapshot.h"
+#include "alloc_counter.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// --- Seeded instances ---
+
+// Only raw mt19937 output is used: it is specified by the standard, distributions are not
+static Problem generateProblem(int numEntries, unsigned seed) {
+    std::mt19937 rng(seed);
+    static const char* days[] = {"Понедельник", "Вторник", "Среда", "Четверг", "Пятница", "Суббота"};
+    const int numSlots = 6;
+    int numGroups = std::max(4, numEntries / 24);
+    int numTeachers = std::max(4, numEntries / 18);
+    int numRooms = std::max(6, numEntries / 20);
+    int numSubjects = 20 + numEntries / 100;
+
+    Problem problem;
+    for (int s = 0; s < numSlots; ++s) {
+        problem.timeSlots.push_back({"ts" + std::to_string(s), std::to_string(s + 1) + " пара", s});
+    }
+    for (int t = 0; t < numTeachers; ++t) {
+        Teacher teacher;
+        teacher.id = "t" + std::to_string(t);
+        teacher.name = "Преподаватель " + std::to_string(t);
+        // A few forbidden and undesirable cells per teacher
+        for (int k = 0; k < 3; ++k) {
+            teacher.availabilityGrid.grid[days[rng() % 6]]["ts" + std::to_string(rng() % numSlots)] =
+                k == 0 ? AvailabilityType::Forbidden : AvailabilityType::Undesirable;
+        }
+        if (t % 10 == 0) teacher.pinnedClassroomId = "c" + std::to_string(rng() % numRooms);
+        problem.teachers.push_back(teacher);
+    }
+    for (int g = 0; g < numGroups; ++g) {
+        Group group;
+        group.id = "g" + std::to_string(g);
+        group.name = "Группа " + std::to_string(g);
+        group.studentCount = 20 + rng() % 10;
+        group.course = 1 + g % 4;
+        if (g % 7 == 0) group.availabilityGrid.grid[days[5]]["ts" + std::to_string(numSlots - 1)] = AvailabilityType::Forbidden;
+        problem.groups.push_back(group);
+    }
+    for (int c = 0; c < numRooms; ++c) {
+        Classroom room;
+        room.id = "c" + std::to_string(c);
+        room.name = "Ауд. " + std::to_string(100 + c);
+        room.typeId = c % 3 == 0 ? "lecture" : "practice";
+        room.capacity = c % 3 == 0 ? 120 : 30;
+        if (c % 5 == 1) room.tagIds.push_back("pc");
+        problem.classrooms.push_back(room);
+    }
+    for (int s = 0; s < numSubjects; ++s) {
+        Subject subject;
+        subject.id = "s" + std::to_string(s);
+        subject.name = "Дисциплина " + std::to_string(s);
+        subject.classroomTypeRequirements["Лекция"] = {"lecture"};
+        subject.classroomTypeRequirements["Практика"] = {"practice"};
+        if (s % 8 == 3) subject.requiredClassroomTagIds.push_back("pc");
+        problem.subjects.push_back(subject);
+    }
+    for (int i = 0; i < numEntries; ++i) {
+        UnscheduledEntry entry;
+        entry.uid = "e" + std::to_string(i);
+        entry.subjectId = "s" + std::to_string(rng() % numSubjects);
+        entry.teacherId = "t" + std::to_string(rng() % numTeachers);
+        int g = i % numGroups;
+        entry.groupIds.push_back("g" + std::to_string(g));
+        if (i % 4 == 0) {
+            // Stream lecture for two groups
+            entry.classType = "Лекция";
+            entry.groupIds.push_back("g" + std::to_string((g + 1) % numGroups));
+            entry.studentCount = 60;
+        } else {
+            entry.classType = "Практика";
+            entry.studentCount = problem.groups[g].studentCount;
+        }
+        problem.entries.push_back(entry);
+    }
+    return problem;
+}
+
+static Config benchConfig() {
+    Config config;
+    config.strictness = 5;
+    config.settings = {false, true, false, false};
+    config.enforceLectureOrder = true;
+    config.distributeEvenly = true;
+    config.decomposition.enabled = false;
+    return config;
+}
+
+// --- Measurement ---
+
+struct Measurement {
+    std::string kernel;
+    int entries;
+    long long ops;
+    double nsPerOp;
+    double allocsPerOp;
+};
+
+static volatile double g_sink = 0;
+
+static int g_repetitions = 3;
+
+static std::filesystem::path g_workDir;
+
+// Grows the batch until it takes at least minSeconds, then keeps the fastest of
+// g_repetitions batches of that size to damp scheduler noise
+template <typename Body>
+static Measurement measure(const char* kernel, int entries, double minSeconds, Body body) {
+    body(); // warm-up
+    long long ops = 1;
+    int repetitions = 0;
+    Measurement best = { kernel, entries, 0, std::numeric_limits<double>::max(), 0 };
+    for (;;) {
+        long long allocsBefore = allocationCount();
+        auto start = std::chrono::steady_clock::now();
+        for (long long i = 0; i < ops; ++i) body();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        long long allocs = allocationCount() - allocsBefore;
+        if (ns >= minSeconds * 1e9 || ops >= (1LL << 32)) {
+            if (ns / ops < best.nsPerOp) best = { kernel, entries, ops, ns / ops, (double)allocs / ops };
+            if (++repetitions >= g_repetitions) return best;
+            continue;
+        }
+        double target = minSeconds * 1e9 / std::max(ns, 1.0) * ops * 1.2;
+        ops = std::max(ops * 2, std::min((long long)target, ops * 100));
+    }
+}
+
+struct SchedulerBench {
+    static void run(int numEntries, double minSeconds, std::vector<Measurement>& out) {
+        Problem problem = generateProblem(numEntries, 20240917u + numEntries);
+        Config config = benchConfig();
+
+        // Wrapper parsing: the C ABI problem/config buffers
+        std::vector<uint8_t> problemBuffer = encodeProblem(problem);
+        std::vector<uint8_t> configBuffer = encodeConfig(config);
+        out.push_back(measure("parseProblem", numEntries, minSeconds, [&] {
+            Problem decoded;
+            Config decodedConfig;
+            std::string error;
+            decodeProblem(problemBuffer.data(), problemBuffer.size(), decoded, error);
+            decodeConfig(configBuffer.data(), configBuffer.size(), decodedConfig, error);
+            g_sink = g_sink + decoded.entries.size();
+        }));
+
+        out.push_back(measure("indexify", numEntries, minSeconds, [&] {
+            Scheduler scheduler;
+            scheduler.loadData(problem, config);
+            g_sink = g_sink + scheduler.signatureRooms_.size();
+        }));
+
+        Scheduler scheduler;
+        scheduler.loadData(problem, config);
+
+        // The same index from a precompiled snapshot, source hash check included
+        std::string error;
+        std::string snapshotPath = (g_workDir / ("scheduler_bench_" + std::to_string(numEntries) + ".snap")).string();
+        if (scheduler.saveSnapshot(snapshotPath, hashProblemBuffer(problemBuffer.data(), problemBuffer.size()), error)) {
+            out.push_back(measure("loadSnapshot", numEntries, minSeconds, [&] {
+                Scheduler loaded;
+                uint64_t sourceHash = hashProblemBuffer(problemBuffer.data(), problemBuffer.size());
+                g_sink = g_sink + loaded.loadSnapshot(snapshotPath, sourceHash, config, error);
+            }));
+            std::remove(snapshotPath.c_str());
+        } else {
+            std::fprintf(stderr, "loadSnapshot skipped: %s\n", error.c_str());
+        }
+
+        Scheduler::SolveContext ctx;
+        for (int i = 0; i < numEntries; ++i) ctx.entries.push_back(i);
+        ctx.config = &config;
+
+        // Greedy start, as in solveContext
+        std::vector<Placement> placements(numEntries);
+        Scheduler::Occupancy occupancy = scheduler.buildOccupancy(placements, ctx);
+        Scheduler::OccupancyView view;
+        view.base = &occupancy;
+        for (int e : ctx.entries) {
+            Placement p;
+            if (!scheduler.placeEntry(e, view, false, p)) continue;
+            placements[e] = p;
+            scheduler.applyToOccupancy(occupancy, e, p, 1);
+        }
+
+        // Greedy inner conflict scan: one entry against the filled occupancy
+        int next = 0;
+        out.push_back(measure("placeEntry", numEntries, minSeconds, [&] {
+            Placement p;
+            g_sink = g_sink + scheduler.placeEntry(next, view, false, p);
+            next = (next + 1) % numEntries;
+        }));
+
+        out.push_back(measure("calculateCost", numEntries, minSeconds, [&] {
+            g_sink = g_sink + scheduler.calculateCost(placements, &ctx);
+        }));
+
+        // One annealing move with the incremental distribution tracker, as in runAnnealing
+        std::vector<int> placed;
+        for (int e : ctx.entries) if (placements[e].day >= 0) placed.push_back(e);
+        if (placed.empty()) return;
+        std::vector<Placement> local = placements;
+        DistributionTracker tracker(scheduler.distributionModel_, config);
+        for (int e : ctx.entries) tracker.add(e, local[e]);
+        std::mt19937 rng(7);
+        double currentCost = scheduler.calculateCost(local, &ctx, nullptr, &tracker);
+        double temperature = 50.0;
+        int numDays = scheduler.workDays_.size();
+        int numSlots = scheduler.timeSlots_.size();
+        int numRooms = scheduler.classrooms_.size();
+        out.push_back(measure("annealingStep", numEntries, minSeconds, [&] {
+            int idx = placed[rng() % placed.size()];
+            Placement previous = local[idx];
+            Placement& p = local[idx];
+            p.day = rng() % numDays;
+            p.slot = rng() % numSlots;
+            p.room = rng() % numRooms;
+            tracker.remove(idx, previous);
+            tracker.add(idx, p);
+            double neighborCost = scheduler.calculateCost(local, &ctx, nullptr, &tracker);
+            double delta = neighborCost - currentCost;
+            if (delta < 0 || std::exp(-delta / temperature) > (rng() >> 8) / 16777216.0) {
+                currentCost = neighborCost;
+            } else {
+                tracker.remove(idx, p);
+                tracker.add(idx, previous);
+                p = previous;
+            }
+        }));
+    }
+};
+
+static std::string toJson(const std::vector<Measurement>& results, double minSeconds) {
+    std::ostringstream os;
+    os.precision(6);
+    os << "{\n  \"version\": 1,\n  \"minTimeSeconds\": " << minSeconds << ",\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Measurement& m = results[i];
+        os << "    { \"kernel\": \"" << m.kernel << "\", \"entries\": " << m.entries
+           << ", \"ops\": " << m.ops
+           << ", \"nsPerOp\": " << std::fixed << m.nsPerOp
+           << ", \"allocsPerOp\": " << m.allocsPerOp
+           << ", \"movesPerSec\": " << (m.kernel == "annealingStep" ? 1e9 / m.nsPerOp : 0.0)
+           << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+        os.unsetf(std::ios::fixed);
+    }
+    os << "  ]\n}\n";
+    return os.str();
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> sizes = {100, 1000, 10000};
+    double minSeconds = 0.1;
+    const char* outPath = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc) {
+            sizes.clear();
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (std::getline(list, item, ',')) sizes.push_back(std::atoi(item.c_str()));
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            minSeconds = std::atof(argv[++i]);
+        } else if (arg == "--repetitions" && i + 1 < argc) {
+            g_repetitions = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--out" && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (arg == "--work-dir" && i + 1 < argc) {
+            g_workDir = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: %s [--sizes 100,1000,10000] [--min-time 0.1] [--repetitions 3] [--out report.json] "
+                         "[--work-dir dir]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (g_workDir.empty()) {
+        std::error_code ec;
+        g_workDir = std::filesystem::temp_directory_path(ec);
+    }
+
+    std::vector<Measurement> results;
+    for (int size : sizes) {
+        if (size <= 0) continue;
+        SchedulerBench::run(size, minSeconds, results);
+    }
+    for (const Measurement& m : results) {
+        std::fprintf(stderr, "%-14s %6d entries %14.1f ns/op %10.1f allocs/op\n",
+                     m.kernel.c_str(), m.entries, m.nsPerOp, m.allocsPerOp);
+    }
+
+    std::string json = toJson(results, minSeconds);
+    if (!outPath) {
+        std::fputs(json.c_str(), stdout);
+        return 0;
+    }
+    FILE* file = std::fopen(outPath, "wb");
+    if (!file) {
+        std::fprintf(stderr, "Cannot write %s\n", outPath);
+        return 1;
+    }
+    std::fputs(json.c_str(), file);
+    std::fclose(file);
+    return 0;
+}
@@ -0,0 +1,299 @@
+# -*- coding: utf-8 -*-
+"""Обёртка ctypes над C ABI нативного планировщика (libscheduler.so / Scheduler.dll).
+
+Задачи и конфигурации описываются словарями с теми же полями, что и у N-API модуля
+(teachers, groups, classrooms, subjects, timeSlots, entries), и кодируются в бинарный
+формат из native/problem_buffer.h.
+"""
+import ctypes
+import os
+import struct
+
+ABI_VERSION = 1
+
+SCHED_OK = 0
+
+LNS_ACCEPTANCE = {'annealing': 0, 'recordToRecord': 1}
+
+
+class SchedulerError(RuntimeError):
+    pass
+
+
+class _Writer:
+    def __init__(self, magic, version):
+        self.parts = [magic, struct.pack('<I', version)]
+
+    def u8(self, v):
+        self.parts.append(struct.pack('<B', v))
+
+    def boolean(self, v):
+        self.u8(1 if v else 0)
+
+    def u32(self, v):
+        self.parts.append(struct.pack('<I', v))
+
+    def i32(self, v):
+        self.parts.append(struct.pack('<i', int(v)))
+
+    def f64(self, v):
+        self.parts.append(struct.pack('<d', float(v)))
+
+    def str(self, s):
+        data = (s or '').encode('utf-8')
+        self.u32(len(data))
+        self.parts.append(data)
+
+    def strs(self, items):
+        items = items or []
+        self.u32(len(items))
+        for s in items:
+            self.str(s)
+
+    def grid(self, grid):
+        grid = grid or {}
+        self.u32(len(grid))
+        for day, slots in grid.items():
+            self.str(day)
+            self.u32(len(slots))
+            for slot, kind in slots.items():
+                self.str(slot)
+                self.u8(int(kind))
+
+    def bytes(self):
+        return b''.join(self.parts)
+
+
+class _Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def take(self, fmt):
+        value = struct.unpack_from(fmt, self.data, self.pos)[0]
+        self.pos += struct.calcsize(fmt)
+        return value
+
+    def u32(self):
+        return self.take('<I')
+
+    def i32(self):
+        return self.take('<i')
+
+    def f64(self):
+        return self.take('<d')
+
+    def str(self):
+        n = self.u32()
+        s = self.data[self.pos:self.pos + n].decode('utf-8')
+        self.pos += n
+        return s
+
+    def strs(self):
+        return [self.str() for _ in range(self.u32())]
+
+
+def encode_problem(problem):
+    """Кодирует задачу в буфер формата SPRB."""
+    w = _Writer(b'SPRB', 1)
+    teachers = problem.get('teachers', [])
+    w.u32(len(teachers))
+    for t in teachers:
+        w.str(t['id']); w.str(t.get('name')); w.str(t.get('pinnedClassroomId'))
+        w.grid(t.get('availabilityGrid'))
+    groups = problem.get('groups', [])
+    w.u32(len(groups))
+    for g in groups:
+        w.str(g['id']); w.str(g.get('name'))
+        w.i32(g.get('studentCount', 0)); w.i32(g.get('course', 0))
+        w.str(g.get('pinnedClassroomId'))
+        w.grid(g.get('availabilityGrid'))
+    classrooms = problem.get('classrooms', [])
+    w.u32(len(classrooms))
+    for c in classrooms:
+        w.str(c['id']); w.str(c.get('name')); w.i32(c.get('capacity', 0))
+        w.str(c.get('typeId')); w.strs(c.get('tagIds'))
+    subjects = problem.get('subjects', [])
+    w.u32(len(subjects))
+    for s in subjects:
+        w.str(s['id']); w.str(s.get('name')); w.str(s.get('pinnedClassroomId'))
+        w.strs(s.get('requiredClassroomTagIds'))
+        reqs = s.get('classroomTypeRequirements') or {}
+        w.u32(len(reqs))
+        for class_type, room_types in reqs.items():
+            w.str(class_type); w.strs(room_types)
+    time_slots = problem.get('timeSlots', [])
+    w.u32(len(time_slots))
+    for ts in time_slots:
+        w.str(ts['id']); w.str(ts.get('name')); w.i32(ts.get('order', 0))
+    entries = problem.get('entries', [])
+    w.u32(len(entries))
+    for e in entries:
+        w.str(e['uid']); w.str(e.get('subjectId')); w.str(e.get('teacherId'))
+        w.str(e.get('classType')); w.i32(e.get('studentCount', 0))
+        w.strs(e.get('groupIds') or ([e['groupId']] if e.get('groupId') else []))
+    return w.bytes()
+
+
+def encode_config(config):
+    """Кодирует конфигурацию в буфер формата SCFG (значения по умолчанию как в scheduler.h)."""
+    settings = config.get('settings') or {}
+    lns = config.get('lns') or {}
+    decomposition = config.get('decomposition') or {}
+    w = _Writer(b'SCFG', 1)
+    w.i32(config.get('strictness', 5))
+    w.boolean(settings.get('allowWindows', False))
+    w.boolean(settings.get('enforceStandardRules', False))
+    w.boolean(settings.get('respectProductionCalendar', False))
+    w.boolean(settings.get('useShortenedPreHolidaySchedule', False))
+    w.boolean(config.get('enforceLectureOrder', False))
+    w.boolean(config.get('distributeEvenly', False))
+    w.f64(config.get('timeLimitSeconds', 0))
+    w.boolean(lns.get('enabled', False))
+    w.i32(lns.get('iterations', 200))
+    w.i32(lns.get('parallelRepairs', 4))
+    w.f64(lns.get('destroyFraction', 0.1))
+    w.u8(LNS_ACCEPTANCE[lns.get('acceptance', 'annealing')])
+    w.f64(lns.get('recordDeviation', 0.02))
+    w.boolean(decomposition.get('enabled', False))
+    w.f64(decomposition.get('maxRoomOverlap', 0.5))
+    rules = config.get('schedulingRules') or []
+    w.u32(len(rules))
+    for rule in rules:
+        w.str(rule.get('id')); w.i32(rule.get('action', 0)); w.i32(rule.get('severity', 0))
+        w.str(rule.get('day')); w.str(rule.get('timeSlotId')); w.i32(rule.get('param', 0))
+        conditions = rule.get('conditions') or []
+        w.u32(len(conditions))
+        for cond in conditions:
+            w.str(cond.get('entityType')); w.strs(cond.get('entityIds')); w.str(cond.get('classType'))
+    return w.bytes()
+
+
+def decode_results(data):
+    """Разбирает буфер результатов SRES в список сценариев."""
+    r = _Reader(data)
+    if data[:4] != b'SRES':
+        raise SchedulerError('bad result buffer magic')
+    r.pos = 4
+    if r.u32() != 2:
+        raise SchedulerError('unsupported result buffer version')
+    scenarios = []
+    for _ in range(r.u32()):
+        cost = {key: r.f64() for key in
+                ('hardConflicts', 'availability', 'pinnedRooms', 'dailyLoad', 'distribution', 'rules', 'total')}
+        unscheduled = r.i32()
+        seconds = r.f64()
+        schedule = []
+        for _ in range(r.u32()):
+            entry = {key: r.str() for key in
+                     ('id', 'day', 'timeSlotId', 'classroomId', 'subjectId', 'teacherId',
+                      'classType', 'unscheduledUid')}
+            entry['groupIds'] = r.strs()
+            schedule.append(entry)
+        scenarios.append({'cost': cost, 'unscheduled': unscheduled, 'seconds': seconds, 'schedule': schedule})
+    return scenarios
+
+
+class SchedulerLibrary:
+    """Загруженная библиотека планировщика."""
+
+    def __init__(self, path):
+        lib = ctypes.CDLL(path)
+        u8p = ctypes.POINTER(ctypes.c_uint8)
+        lib.sched_abi_version.restype = ctypes.c_uint32
+        lib.sched_last_error.restype = ctypes.c_char_p
+        lib.sched_problem_create.argtypes = [u8p, ctypes.c_size_t, ctypes.POINTER(ctypes.c_void_p)]
+        lib.sched_problem_free.argtypes = [ctypes.c_void_p]
+        lib.sched_problem_free.restype = None
+        lib.sched_problem_save_snapshot.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+        lib.sched_problem_save_snapshot_rules.argtypes = [ctypes.c_void_p, ctypes.c_char_p, u8p, ctypes.c_size_t]
+        lib.sched_problem_open_snapshot.argtypes = [ctypes.c_char_p, u8p, ctypes.c_size_t,
+                                                    ctypes.POINTER(ctypes.c_void_p)]
+        lib.sched_solve_batch.argtypes = [ctypes.c_void_p, ctypes.POINTER(u8p), ctypes.POINTER(ctypes.c_size_t),
+                                          ctypes.c_size_t, ctypes.POINTER(u8p), ctypes.POINTER(ctypes.c_size_t)]
+        lib.sched_buffer_free.argtypes = [u8p]
+        lib.sched_buffer_free.restype = None
+        if lib.sched_abi_version() != ABI_VERSION:
+            raise SchedulerError('unsupported ABI version %d' % lib.sched_abi_version())
+        self.lib = lib
+
+    def check(self, code):
+        if code != SCHED_OK:
+            raise SchedulerError(self.lib.sched_last_error().decode('utf-8', 'replace'))
+
+    def load_problem(self, problem):
+        """Создаёт постоянную задачу: данные разбираются и индексируются один раз."""
+        return Problem(self, encode_problem(problem))
+
+    def open_snapshot(self, path, problem):
+        """Открывает предкомпилированный снимок задачи без повторной индексации.
+
+        problem — исходные данные (словарь или буфер SPRB): по их хешу отбраковываются
+        устаревшие снимки.
+        """
+        data = problem if isinstance(problem, bytes) else encode_problem(problem)
+        return Problem(self, data, snapshot=path)
+
+
+def _as_u8(data):
+    return ctypes.cast(ctypes.create_string_buffer(data, len(data)), ctypes.POINTER(ctypes.c_uint8))
+
+
+class Problem:
+    def __init__(self, library, data, snapshot=None):
+        self.library = library
+        self.handle = ctypes.c_void_p()
+        if snapshot is None:
+            library.check(library.lib.sched_problem_create(_as_u8(data), len(data), ctypes.byref(self.handle)))
+        else:
+            library.check(library.lib.sched_problem_open_snapshot(os.fsencode(snapshot), _as_u8(data), len(data),
+                                                                  ctypes.byref(self.handle)))
+
+    def save_snapshot(self, path, config=None):
+        """Сохраняет проиндексированную задачу в файл снимка.
+
+        С config в снимок попадают и скомпилированные правила этой конфигурации:
+        решение открытого снимка с теми же правилами не компилирует их заново.
+        """
+        lib = self.library.lib
+        if config is None:
+            self.library.check(lib.sched_problem_save_snapshot(self.handle, os.fsencode(path)))
+            return
+        encoded = encode_config(config)
+        self.library.check(lib.sched_problem_save_snapshot_rules(self.handle, os.fsencode(path),
+                                                                 _as_u8(encoded), len(encoded)))
+
+    def solve(self, config):
+        return self.solve_batch([config])[0]
+
+    def solve_batch(self, configs):
+        """Решает задачу для нескольких конфигураций параллельно."""
+        lib = self.library.lib
+        encoded = [encode_config(c) for c in configs]
+        buffers = [ctypes.create_string_buffer(b, len(b)) for b in encoded]
+        u8p = ctypes.POINTER(ctypes.c_uint8)
+        pointers = (u8p * len(buffers))(*[ctypes.cast(b, u8p) for b in buffers])
+        sizes = (ctypes.c_size_t * len(encoded))(*[len(b) for b in encoded])
+        out = u8p()
+        out_size = ctypes.c_size_t()
+        self.library.check(lib.sched_solve_batch(self.handle, pointers, sizes, len(encoded),
+                                                 ctypes.byref(out), ctypes.byref(out_size)))
+        try:
+            data = ctypes.string_at(out, out_size.value)
+        finally:
+            lib.sched_buffer_free(out)
+        return decode_results(data)
+
+    def close(self):
+        if self.handle:
+            self.library.lib.sched_problem_free(self.handle)
+            self.handle = ctypes.c_void_p()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
@@ -0,0 +1,196 @@
+// Decomposition: parts solved apart on reserved room cells, merged and completed by
+// placeLeftovers, must give a schedule without teacher, group or room double bookings.
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+#include "scheduler.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { std::printf("FAIL %s:%d: ", __FILE__, __LINE__); std::printf(__VA_ARGS__); std::printf("\n"); failures++; } \
+} while (0)
+
+static const char* kDays[] = {"Понедельник", "Вторник", "Среда", "Четверг", "Пятница", "Суббота"};
+
+// Reaches the solve stages that solve() chains together
+struct SchedulerTest {
+    Scheduler& s;
+
+    std::vector<Scheduler::SolveContext> decompose(const Config& config, int threads) { return s.decompose(config, threads); }
+    std::vector<Placement> solvePlacements(const Config& config, int threads) { return s.solvePlacements(config, threads); }
+    void placeLeftovers(std::vector<Placement>& placements) { s.placeLeftovers(placements); }
+    int entry(const std::string& uid) { return s.entryIdx_.at(uid); }
+    int cells() const { return s.workDays_.size() * s.timeSlots_.size(); }
+
+    // Classes beyond the first in any teacher, group or room cell
+    int doubleBookings(const std::vector<Placement>& placements) const {
+        std::map<std::pair<std::string, int>, int> used;
+        int extra = 0;
+        for (size_t e = 0; e < placements.size(); ++e) {
+            const Placement& p = placements[e];
+            if (p.day < 0) continue;
+            int offset = p.day * s.timeSlots_.size() + p.slot;
+            std::vector<std::string> keys;
+            if (s.entryTeacher_[e] != -1) keys.push_back("t" + std::to_string(s.entryTeacher_[e]));
+            for (int g : s.entryGroups_[e]) keys.push_back("g" + std::to_string(g));
+            if (p.room != -1) keys.push_back("r" + std::to_string(p.room));
+            for (const auto& key : keys) {
+                if (used[std::make_pair(key, offset)]++ > 0) extra++;
+            }
+        }
+        return extra;
+    }
+};
+
+static TimeSlot slot(int s) {
+    TimeSlot ts;
+    ts.id = "ts" + std::to_string(s);
+    ts.name = std::to_string(s + 1) + " пара";
+    ts.order = s;
+    return ts;
+}
+
+static Classroom room(const std::string& id, const std::string& tag) {
+    Classroom c;
+    c.id = id;
+    c.name = id;
+    c.capacity = 30;
+    c.typeId = "practice";
+    if (!tag.empty()) c.tagIds.push_back(tag);
+    return c;
+}
+
+static Group group(const std::string& id) {
+    Group g;
+    g.id = id;
+    g.name = id;
+    g.studentCount = 25;
+    g.course = 1;
+    return g;
+}
+
+static UnscheduledEntry entry(const std::string& uid, const std::string& subject, const std::string& teacher,
+                              const std::string& groupId) {
+    UnscheduledEntry e;
+    e.uid = uid;
+    e.subjectId = subject;
+    e.teacherId = teacher;
+    e.groupIds.push_back(groupId);
+    e.classType = "Практика";
+    e.studentCount = 25;
+    return e;
+}
+
+// Departments with their own teachers and groups competing for one pool of rooms
+static Problem departments(int numDepartments) {
+    Problem problem;
+    for (int s = 0; s < 4; ++s) problem.timeSlots.push_back(slot(s));
+    for (int c = 0; c < 5; ++c) problem.classrooms.push_back(room("c" + std::to_string(c), ""));
+    Subject subject;
+    subject.id = "s";
+    subject.name = "Дисциплина";
+    problem.subjects.push_back(subject);
+
+    for (int d = 0; d < numDepartments; ++d) {
+        std::string dep = "d" + std::to_string(d);
+        for (int t = 0; t < 3; ++t) {
+            Teacher teacher;
+            teacher.id = dep + "t" + std::to_string(t);
+            teacher.name = teacher.id;
+            problem.teachers.push_back(teacher);
+        }
+        for (int g = 0; g < 3; ++g) problem.groups.push_back(group(dep + "g" + std::to_string(g)));
+        for (int i = 0; i < 27; ++i) {
+            problem.entries.push_back(entry(dep + "e" + std::to_string(i), "s", dep + "t" + std::to_string(i % 3),
+                                            dep + "g" + std::to_string(i / 9)));
+        }
+    }
+    return problem;
+}
+
+static void testDecomposedSolve() {
+    Problem problem = departments(3);
+    Config config;
+    config.decomposition.enabled = true;
+    config.decomposition.maxRoomOverlap = 1.0; // every department is a part of its own
+    Scheduler scheduler;
+    scheduler.loadData(problem, config);
+    SchedulerTest t{ scheduler };
+
+    auto contexts = t.decompose(config, 3);
+    CHECK(contexts.size() == 3, "%zu contexts for 3 departments", contexts.size());
+    // Every room cell belongs to exactly one context
+    int cells = t.cells();
+    int badCells = 0;
+    for (int cell = 0; cell < (int)problem.classrooms.size() * cells; ++cell) {
+        int owners = 0;
+        for (const auto& ctx : contexts) owners += ctx.reservedRooms[cell] == 0;
+        badCells += owners != 1;
+    }
+    CHECK(badCells == 0, "%d room cells without exactly one owner", badCells);
+
+    std::vector<Placement> merged = t.solvePlacements(config, 3);
+    int unplaced = 0;
+    for (const auto& p : merged) unplaced += p.day < 0;
+    CHECK(unplaced == 0, "%d of %zu entries unplaced", unplaced, merged.size());
+    CHECK(t.doubleBookings(merged) == 0, "merged schedule has %d double bookings", t.doubleBookings(merged));
+
+    // Entries dropped from the merged schedule are placed again on the cells left free
+    for (int e = 0; e < (int)merged.size(); e += 7) merged[e] = Placement();
+    t.placeLeftovers(merged);
+    unplaced = 0;
+    for (const auto& p : merged) unplaced += p.day < 0;
+    CHECK(unplaced == 0, "placeLeftovers left %d entries unplaced", unplaced);
+    CHECK(t.doubleBookings(merged) == 0, "placeLeftovers made %d double bookings", t.doubleBookings(merged));
+}
+
+static void testEviction() {
+    // X needs the tagged room c1 and its teacher is free on Monday only, where Y sits in c1;
+    // Y fits any room, so it is moved to make room for X
+    Problem problem;
+    problem.timeSlots.push_back(slot(0));
+    problem.classrooms.push_back(room("c0", ""));
+    problem.classrooms.push_back(room("c1", "pc"));
+    Subject tagged;
+    tagged.id = "sx";
+    tagged.requiredClassroomTagIds.push_back("pc");
+    Subject plain;
+    plain.id = "sy";
+    problem.subjects = { tagged, plain };
+    Teacher tx;
+    tx.id = "tx";
+    for (int d = 1; d < 6; ++d) tx.availabilityGrid.grid[kDays[d]]["ts0"] = AvailabilityType::Forbidden;
+    Teacher ty;
+    ty.id = "ty";
+    problem.teachers = { tx, ty };
+    problem.groups = { group("gx"), group("gy") };
+    problem.entries = { entry("x", "sx", "tx", "gx"), entry("y", "sy", "ty", "gy") };
+
+    Scheduler scheduler;
+    scheduler.loadData(problem, Config());
+    SchedulerTest t{ scheduler };
+    std::vector<Placement> placements(2);
+    Placement& y = placements[t.entry("y")];
+    y.day = 0;
+    y.slot = 0;
+    y.room = 1;
+    t.placeLeftovers(placements);
+
+    const Placement& x = placements[t.entry("x")];
+    CHECK(x.day == 0 && x.room == 1, "x at day %d room %d, expected Monday in c1", x.day, x.room);
+    CHECK(placements[t.entry("y")].day >= 0, "y lost its place");
+    CHECK(t.doubleBookings(placements) == 0, "eviction made %d double bookings", t.doubleBookings(placements));
+}
+
+int main() {
+    testDecomposedSolve();
+    testEviction();
+    if (failures) {
+        std::printf("decomposition_test: %d failures\n", failures);
+        return 1;
+    }
+    std::printf("decomposition_test passed\n");
+    return 0;
+}
@@ -0,0 +1,241 @@
+// DistributionTracker: the incrementally maintained penalty must equal a full rebuild,
+// and the terms must follow calculateSlotCost of the TS scheduler.
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "scheduler.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { std::printf("FAIL %s:%d: ", __FILE__, __LINE__); std::printf(__VA_ARGS__); std::printf("\n"); failures++; } \
+} while (0)
+
+// Reaches the cost model the solver uses
+struct SchedulerTest {
+    Scheduler& s;
+
+    double cost(const std::vector<Placement>& placements) { return s.calculateCost(placements); }
+};
+
+struct Class {
+    int subject;
+    int kind;
+    std::vector<int> groups;
+};
+
+static DistributionTracker::Model makeModel(const std::vector<Class>& classes, int numGroups) {
+    DistributionTracker::Model m;
+    m.numDays = 6;
+    m.numSlots = 6;
+    m.numGroups = numGroups;
+    m.saturday = 5;
+    std::vector<std::vector<int>> groups;
+    for (const auto& c : classes) {
+        groups.push_back(c.groups);
+        m.entryKind.push_back(c.kind);
+        m.entrySubject.push_back(c.subject);
+    }
+    m.entryGroups = IndexLists(groups);
+    return m;
+}
+
+static Config allTerms() {
+    Config config;
+    config.strictness = 5;
+    config.settings.enforceStandardRules = true;
+    config.enforceLectureOrder = true;
+    config.distributeEvenly = true;
+    return config;
+}
+
+// The terms written out directly from their definitions, weights for strictness 5
+static double reference(const std::vector<Class>& classes, const std::vector<Placement>& at,
+                        const DistributionTracker::Model& m) {
+    double total = 0;
+    std::vector<std::vector<int>> load(m.numGroups, std::vector<int>(m.numDays, 0));
+    for (size_t i = 0; i < classes.size(); ++i) {
+        if (at[i].day < 0) continue;
+        if (at[i].day == m.saturday) total += 60 + 25;
+        for (int g : classes[i].groups) load[g][at[i].day]++;
+        bool repeat = false, own = false, other = false;
+        for (size_t j = 0; j < classes.size(); ++j) {
+            // Earlier that day by (slot, index), sharing a group
+            if (at[j].day != at[i].day || at[j].slot > at[i].slot) continue;
+            if (at[j].slot == at[i].slot && j >= i) continue;
+            bool shared = false;
+            for (int g : classes[i].groups) {
+                for (int h : classes[j].groups) shared = shared || g == h;
+            }
+            if (!shared) continue;
+            if (classes[j].subject == classes[i].subject) repeat = true;
+            if (classes[i].kind != DistributionTracker::Lecture || classes[j].kind != DistributionTracker::Practice) continue;
+            if (at[j].slot == at[i].slot) continue;
+            if (classes[j].subject == classes[i].subject) own = true;
+            else other = true;
+        }
+        if (repeat) total += 75;
+        if (own) total += 300;
+        if (other) total += 350;
+    }
+    for (int g = 0; g < m.numGroups; ++g) {
+        double week = 0, squares = 0;
+        for (int d = 0; d < m.numDays; ++d) {
+            week += load[g][d];
+            squares += load[g][d] * load[g][d];
+        }
+        total += 10 * (squares - week * week / m.numDays);
+    }
+    return total;
+}
+
+static Placement cell(int day, int slot) {
+    Placement p;
+    p.day = day;
+    p.slot = slot;
+    p.room = 0;
+    return p;
+}
+
+static double penaltyOf(const std::vector<Class>& classes, const std::vector<Placement>& at, const Config& config) {
+    DistributionTracker::Model m = makeModel(classes, 2);
+    DistributionTracker tracker(m, config);
+    for (size_t i = 0; i < classes.size(); ++i) tracker.add(i, at[i]);
+    return tracker.penalty();
+}
+
+static void testRules() {
+    using DT = DistributionTracker;
+    Config standard;
+    standard.settings.enforceStandardRules = true;
+    Config order;
+    order.enforceLectureOrder = true;
+
+    // A practice of another subject any earlier slot that day puts the lecture after it
+    std::vector<Class> classes = { { 0, DT::Practice, { 0 } }, { 1, DT::Lecture, { 0 } } };
+    CHECK(penaltyOf(classes, { cell(0, 0), cell(0, 3) }, standard) == 350, "lecture after other practice");
+    CHECK(penaltyOf(classes, { cell(0, 3), cell(0, 0) }, standard) == 0, "lecture before other practice");
+    CHECK(penaltyOf(classes, { cell(0, 0), cell(1, 3) }, standard) == 0, "practice on another day");
+    // ... but not a practice of the lecture's own subject
+    classes[0].subject = 1;
+    CHECK(penaltyOf(classes, { cell(0, 0), cell(0, 3) }, standard) == 75, "own practice is a repeat only");
+
+    // Lecture order holds per day: a practice on Monday and the lecture on Tuesday is fine
+    CHECK(penaltyOf(classes, { cell(0, 0), cell(1, 0) }, order) == 0, "order across days");
+    CHECK(penaltyOf(classes, { cell(1, 0), cell(1, 2) }, order) == 300, "order within a day");
+
+    // A lecture of two groups is charged once
+    classes = { { 0, DT::Practice, { 0 } }, { 0, DT::Practice, { 1 } }, { 0, DT::Lecture, { 0, 1 } } };
+    CHECK(penaltyOf(classes, { cell(2, 0), cell(2, 1), cell(2, 4) }, order) == 300, "stream lecture charged once");
+    // ... and so is its repeat of the subject both groups already had that day
+    Config both = standard;
+    both.enforceLectureOrder = true;
+    CHECK(penaltyOf(classes, { cell(2, 0), cell(2, 1), cell(2, 4) }, both) == 300 + 75,
+          "stream lecture repeat charged once");
+
+    // Saturday is penalized without the standard rules too
+    classes = { { 0, DT::Other, { 0 } } };
+    CHECK(penaltyOf(classes, { cell(5, 0) }, Config()) == 25, "saturday without standard rules");
+    CHECK(penaltyOf(classes, { cell(5, 0) }, standard) == 85, "saturday with standard rules");
+}
+
+static void testIncremental() {
+    std::mt19937 rng(11);
+    const int numGroups = 5;
+    std::vector<Class> classes;
+    for (int i = 0; i < 80; ++i) {
+        Class c;
+        c.subject = rng() % 4;
+        c.kind = rng() % 3;
+        c.groups.push_back(rng() % numGroups);
+        if (rng() % 4 == 0) c.groups.push_back((c.groups[0] + 1 + rng() % (numGroups - 1)) % numGroups);
+        classes.push_back(c);
+    }
+    DistributionTracker::Model m = makeModel(classes, numGroups);
+    Config config = allTerms();
+
+    DistributionTracker tracker(m, config);
+    std::vector<Placement> at(classes.size());
+    for (int step = 0; step < 4000; ++step) {
+        int i = rng() % classes.size();
+        tracker.remove(i, at[i]);
+        at[i] = rng() % 8 == 0 ? Placement() : cell(rng() % m.numDays, rng() % m.numSlots);
+        tracker.add(i, at[i]);
+
+        if (step % 50 != 0) continue;
+        DistributionTracker rebuilt(m, config);
+        for (size_t k = 0; k < classes.size(); ++k) rebuilt.add(k, at[k]);
+        double expected = reference(classes, at, m);
+        CHECK(std::fabs(tracker.penalty() - rebuilt.penalty()) < 1e-6,
+              "step %d: incremental %.3f, rebuilt %.3f", step, tracker.penalty(), rebuilt.penalty());
+        CHECK(std::fabs(rebuilt.penalty() - expected) < 1e-6,
+              "step %d: rebuilt %.3f, reference %.3f", step, rebuilt.penalty(), expected);
+    }
+}
+
+// Groups g0..g<numGroups-1>, each with one class of its own subject per slot of Saturday
+static Problem saturdayClasses(int numGroups, int numSlots) {
+    Problem problem;
+    for (int s = 0; s < numSlots; ++s) {
+        TimeSlot ts;
+        ts.id = "ts" + std::to_string(s);
+        ts.order = s;
+        problem.timeSlots.push_back(ts);
+    }
+    Classroom room;
+    room.id = "c";
+    room.capacity = 30;
+    problem.classrooms.push_back(room);
+    Subject subject;
+    subject.id = "s";
+    problem.subjects.push_back(subject);
+    for (int g = 0; g < numGroups; ++g) {
+        Group group;
+        group.id = "g" + std::to_string(g);
+        group.studentCount = 20;
+        problem.groups.push_back(group);
+        for (int s = 0; s < numSlots; ++s) {
+            UnscheduledEntry e;
+            e.uid = group.id + "e" + std::to_string(s);
+            e.subjectId = "s";
+            e.groupIds.push_back(group.id);
+            e.classType = "Практика";
+            e.studentCount = 20;
+            problem.entries.push_back(e);
+        }
+    }
+    return problem;
+}
+
+static void testReusedScheduler() {
+    // The per-thread tracker of calculateCost must not outlive a reload of the same Scheduler
+    Scheduler reused;
+    SchedulerTest first{ reused };
+    reused.loadData(saturdayClasses(1, 2), allTerms());
+    first.cost({ cell(5, 0), cell(5, 1) });
+
+    Problem larger = saturdayClasses(4, 3);
+    std::vector<Placement> placements;
+    for (int g = 0; g < 4; ++g) {
+        for (int s = 0; s < 3; ++s) placements.push_back(cell(5, s));
+    }
+    reused.loadData(larger, allTerms());
+    Scheduler fresh;
+    fresh.loadData(larger, allTerms());
+    SchedulerTest t{ fresh };
+    CHECK(first.cost(placements) == t.cost(placements), "reloaded %.1f, fresh %.1f",
+          first.cost(placements), t.cost(placements));
+}
+
+int main() {
+    testRules();
+    testIncremental();
+    testReusedScheduler();
+    if (failures) {
+        std::printf("distribution_test: %d failures\n", failures);
+        return 1;
+    }
+    std::printf("distribution_test passed\n");
+    return 0;
+}
@@ -0,0 +1,203 @@
+# -*- coding: utf-8 -*-
+"""Smoke-тест C ABI: решает сгенерированную задачу через ctypes, без Node.
+
+Запуск: python smoke_test.py <путь к libscheduler.so | Scheduler.dll>
+"""
+import os
+import random
+import sys
+import tempfile
+
+# Decomposition only splits the problem with more than one thread
+os.environ.setdefault('OMP_NUM_THREADS', '4')
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'python'))
+
+import schedlib  # noqa: E402
+
+DAYS = ["Понедельник", "Вторник", "Среда", "Четверг", "Пятница", "Суббота"]
+
+
+def generate_problem(num_entries=120, seed=7):
+    rng = random.Random(seed)
+    teachers = [{'id': 't%d' % i} for i in range(12)]
+    groups = [{'id': 'g%d' % i, 'studentCount': 25, 'course': 1 + i % 4} for i in range(10)]
+    classrooms = [{'id': 'c%d' % i, 'capacity': 30 if i % 3 else 90, 'typeId': 'lecture' if i % 3 == 0 else 'practice'}
+                  for i in range(9)]
+    subjects = [{'id': 's%d' % i, 'classroomTypeRequirements': {'Лекция': ['lecture']}} for i in range(8)]
+    time_slots = [{'id': 'ts%d' % i, 'order': i} for i in range(6)]
+    # Teacher 0 cannot work on Monday mornings
+    teachers[0]['availabilityGrid'] = {DAYS[0]: {'ts0': 3, 'ts1': 3}}
+    # Group 0 cannot study on Tuesday mornings
+    groups[0]['availabilityGrid'] = {DAYS[1]: {'ts0': 3, 'ts1': 3}}
+    entries = []
+    for i in range(num_entries):
+        entries.append({
+            'uid': 'e%d' % i,
+            'subjectId': 's%d' % rng.randrange(len(subjects)),
+            'teacherId': 't%d' % (i % len(teachers)),
+            'groupIds': ['g%d' % (i % len(groups))],
+            'classType': 'Лекция' if i % 3 == 0 else 'Практика',
+            'studentCount': 25,
+        })
+    return {'teachers': teachers, 'groups': groups, 'classrooms': classrooms, 'subjects': subjects,
+            'timeSlots': time_slots, 'entries': entries}
+
+
+def shared_room_problem(size_a, size_b):
+    """Две независимые части, которые делят одну аудиторию: A — r0..r2, B — r2..r4."""
+    classrooms = [{'id': 'r%d' % i, 'capacity': 40, 'typeId': t}
+                  for i, t in enumerate(['a', 'a', 'shared', 'b', 'b'])]
+    subjects = [{'id': 'sa', 'classroomTypeRequirements': {'Практика': ['a', 'shared']}},
+                {'id': 'sb', 'classroomTypeRequirements': {'Практика': ['shared', 'b']}}]
+    entries = []
+    for name, size, students in (('a', size_a, 30), ('b', size_b, 20)):
+        for i in range(size):
+            entries.append({
+                'uid': '%s%d' % (name, i),
+                'subjectId': 's' + name,
+                'teacherId': '%st%d' % (name, i % 5),
+                'groupIds': ['%sg%d' % (name, (i // 5) % 5)],
+                'classType': 'Практика',
+                'studentCount': students,
+            })
+    teachers = [{'id': '%st%d' % (n, i)} for n in 'ab' for i in range(5)]
+    groups = [{'id': '%sg%d' % (n, i), 'studentCount': 25, 'course': 1} for n in 'ab' for i in range(5)]
+    return {'teachers': teachers, 'groups': groups, 'classrooms': classrooms, 'subjects': subjects,
+            'timeSlots': [{'id': 'ts%d' % i, 'order': i} for i in range(6)], 'entries': entries}
+
+
+def count_conflicts(schedule):
+    seen = set()
+    conflicts = 0
+    for e in schedule:
+        cell = (e['day'], e['timeSlotId'])
+        keys = [('t', e['teacherId']), ('c', e['classroomId'])] + [('g', g) for g in e['groupIds']]
+        for key in keys:
+            if key + cell in seen:
+                conflicts += 1
+            seen.add(key + cell)
+    return conflicts
+
+
+def in_forbidden_cell(e):
+    return ((e['teacherId'] == 't0' and e['day'] == DAYS[0] or 'g0' in e['groupIds'] and e['day'] == DAYS[1])
+            and e['timeSlotId'] in ('ts0', 'ts1'))
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return 2
+    library = schedlib.SchedulerLibrary(sys.argv[1])
+    problem = generate_problem()
+
+    with library.load_problem(problem) as handle:
+        result = handle.solve({'strictness': 5})
+        assert result['unscheduled'] == 0, result['unscheduled']
+        assert len(result['schedule']) == len(problem['entries'])
+        assert count_conflicts(result['schedule']) == 0
+        assert result['cost']['hardConflicts'] == 0, result['cost']
+        assert not any(in_forbidden_cell(e) for e in result['schedule'])
+
+        # The same indexed problem serves several configs at once
+        batch = handle.solve_batch([
+            {'strictness': 5},
+            {'strictness': 10, 'settings': {'enforceStandardRules': True}, 'enforceLectureOrder': True},
+            {'strictness': 5, 'lns': {'enabled': True, 'iterations': 50}, 'timeLimitSeconds': 2},
+        ])
+        assert len(batch) == 3
+        for scenario in batch:
+            assert len(scenario['schedule']) == len(problem['entries'])
+            assert scenario['cost']['hardConflicts'] == 0, scenario['cost']
+            assert not any(in_forbidden_cell(e) for e in scenario['schedule'])
+
+        # Rules are part of the cost: a strict AvoidTime keeps t1 out of the cell,
+        # MaxPerDay (Strong) spreads g1 over the week
+        rules = [
+            {'id': 'avoid', 'action': 0, 'severity': 0, 'day': DAYS[2], 'timeSlotId': 'ts2',
+             'conditions': [{'entityType': 'teacher', 'entityIds': ['t1']}]},
+            {'id': 'max', 'action': 2, 'severity': 1, 'param': 3,
+             'conditions': [{'entityType': 'group', 'entityIds': ['g1']}]},
+        ]
+        ruled = handle.solve({'strictness': 5, 'schedulingRules': rules})
+        assert ruled['cost']['rules'] == 0, ruled['cost']
+        assert not any(e['teacherId'] == 't1' and e['day'] == DAYS[2] and e['timeSlotId'] == 'ts2'
+                       for e in ruled['schedule'])
+        per_day = [sum(1 for e in ruled['schedule'] if 'g1' in e['groupIds'] and e['day'] == d) for d in DAYS]
+        assert max(per_day) <= 3, per_day
+        over = handle.solve({'strictness': 5, 'schedulingRules': [dict(rules[1], param=0)]})
+        assert over['cost']['rules'] == 500 * len([e for e in problem['entries'] if 'g1' in e['groupIds']]), over['cost']
+
+        # Actions the native cost model does not evaluate are rejected, not ignored
+        try:
+            handle.solve({'strictness': 5, 'schedulingRules': [dict(rules[0], action=3)]})
+        except schedlib.SchedulerError as e:
+            assert 'not supported' in str(e), e
+        else:
+            raise AssertionError('unsupported rule action accepted')
+
+    # Decomposition must not leave more entries unscheduled than the monolithic solve
+    for size_a, size_b in ((105, 60), (100, 70), (108, 40)):
+        with library.load_problem(shared_room_problem(size_a, size_b)) as handle:
+            whole = handle.solve({'strictness': 5, 'decomposition': {'enabled': False}})
+            split = handle.solve({'strictness': 5, 'decomposition': {'enabled': True}})
+            assert split['unscheduled'] <= whole['unscheduled'], (size_a, size_b, whole['unscheduled'],
+                                                                  split['unscheduled'])
+            assert split['cost']['hardConflicts'] == 0, split['cost']
+
+    # A precompiled snapshot solves the same problem without re-indexing
+    snapshot = os.path.join(tempfile.mkdtemp(), 'problem.snap')
+    with library.load_problem(problem) as handle:
+        handle.save_snapshot(snapshot)
+    with library.open_snapshot(snapshot, problem) as handle:
+        result = handle.solve({'strictness': 5})
+        assert result['unscheduled'] == 0, result['unscheduled']
+        assert count_conflicts(result['schedule']) == 0
+        assert sorted(e['unscheduledUid'] for e in result['schedule']) == sorted(e['uid'] for e in problem['entries'])
+
+    # Rules compiled into the snapshot are the same rules: MaxPerDay 0 charges every g1 class.
+    # Other rules are compiled as usual.
+    over_config = {'strictness': 5, 'schedulingRules': [dict(rules[1], param=0)]}
+    g1_classes = len([e for e in problem['entries'] if 'g1' in e['groupIds']])
+    with library.load_problem(problem) as handle:
+        handle.save_snapshot(snapshot, over_config)
+    with library.open_snapshot(snapshot, problem) as handle:
+        assert handle.solve(over_config)['cost']['rules'] == 500 * g1_classes
+        assert handle.solve({'strictness': 5, 'schedulingRules': rules})['cost']['rules'] == 0
+
+    # Snapshots of other source data are stale
+    changed = dict(problem, entries=problem['entries'][:-1])
+    try:
+        library.open_snapshot(snapshot, changed)
+    except schedlib.SchedulerError as e:
+        assert 'stale' in str(e), e
+    else:
+        raise AssertionError('stale snapshot accepted')
+    os.remove(snapshot)
+
+    # Malformed buffers are reported, not crashed on
+    try:
+        schedlib.Problem(library, b'SPRB\x01\x00\x00\x00\xff\xff')
+    except schedlib.SchedulerError as e:
+        assert 'problem buffer' in str(e), e
+    else:
+        raise AssertionError('malformed problem accepted')
+
+    # Out-of-range and non-finite config values are format errors
+    with library.load_problem(problem) as handle:
+        for config in ({'lns': {'iterations': -1}}, {'lns': {'parallelRepairs': 0}},
+                       {'lns': {'destroyFraction': float('nan')}}, {'lns': {'recordDeviation': float('inf')}},
+                       {'timeLimitSeconds': -1}, {'decomposition': {'maxRoomOverlap': 1.5}}):
+            try:
+                handle.solve(dict(config, strictness=5))
+            except schedlib.SchedulerError as e:
+                assert 'config buffer' in str(e), e
+            else:
+                raise AssertionError('config accepted: %r' % config)
+
+    print('C ABI smoke test passed: %d entries, total cost %.1f' % (len(result['schedule']), result['cost']['total']))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
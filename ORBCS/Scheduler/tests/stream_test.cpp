@@ -0,0 +1,149 @@
+// SpscQueue and SnapshotStream: values arrive in order, diff versions are contiguous,
+// applying all diffs gives the finished solution, and finish() never waits for the consumer.
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+#include "scheduler.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { std::printf("FAIL %s:%d: ", __FILE__, __LINE__); std::printf(__VA_ARGS__); std::printf("\n"); failures++; } \
+} while (0)
+
+static void testQueue() {
+    SpscQueue<int> queue(4);
+    for (int i = 0; i < 4; ++i) {
+        int v = i;
+        CHECK(queue.push(v), "push %d into a queue with room", i);
+    }
+    int extra = 4;
+    CHECK(!queue.push(extra) && extra == 4, "push into a full queue must fail and keep the value");
+
+    // Producer and consumer on two threads: every value once, in order
+    const int count = 200000;
+    SpscQueue<int> shared(16);
+    std::thread producer([&] {
+        for (int i = 0; i < count; ++i) {
+            int v = i;
+            while (!shared.push(v)) std::this_thread::yield();
+        }
+    });
+    int expected = 0;
+    while (expected < count) {
+        int v;
+        if (!shared.pop(v)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (v != expected) {
+            CHECK(false, "popped %d, expected %d", v, expected);
+            break;
+        }
+        ++expected;
+    }
+    producer.join();
+}
+
+static bool same(const Placement& a, const Placement& b) {
+    return a.day == b.day && a.slot == b.slot && a.room == b.room;
+}
+
+// Applies diffs in order; checks contiguity, returns true once the final diff is applied
+static bool apply(SnapshotStream& stream, std::vector<Placement>& state, int& version) {
+    SnapshotDiff diff;
+    while (stream.pop(diff)) {
+        CHECK(diff.version == version + 1, "version %d after %d", diff.version, version);
+        CHECK(diff.entries.size() == diff.placements.size(), "diff of %zu entries, %zu placements",
+              diff.entries.size(), diff.placements.size());
+        version = diff.version;
+        for (size_t i = 0; i < diff.entries.size(); ++i) state[diff.entries[i]] = diff.placements[i];
+        if (diff.final) return true;
+    }
+    return false;
+}
+
+// Solver threads offer improving solutions of their parts, then the merged one is finished
+static void runStream(size_t capacity, bool slowConsumer, unsigned seed) {
+    const int numEntries = 300;
+    const int numParts = 3;
+    SnapshotStream stream(0, capacity);
+    stream.begin(numEntries, numParts);
+
+    std::vector<Placement> finished(numEntries);
+    std::atomic<bool> done(false);
+    std::vector<Placement> state(numEntries);
+    int version = 0;
+    bool gotFinal = false;
+    std::thread consumer([&] {
+        if (!slowConsumer) {
+            // Reads while the solver runs
+            while (!gotFinal) {
+                gotFinal = apply(stream, state, version);
+                if (!gotFinal) std::this_thread::yield();
+            }
+            return;
+        }
+        // Stalls until the solve is over, then drains
+        while (!done.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        gotFinal = apply(stream, state, version);
+    });
+
+    std::vector<std::thread> solvers;
+    for (int part = 0; part < numParts; ++part) {
+        solvers.emplace_back([&, part] {
+            std::mt19937 rng(seed + part);
+            std::vector<int> entries;
+            for (int e = part; e < numEntries; e += numParts) entries.push_back(e);
+            std::vector<Placement> placements(numEntries);
+            double cost = 1e9;
+            for (int round = 0; round < 400; ++round) {
+                for (int k = 0; k < 5; ++k) {
+                    Placement& p = placements[entries[rng() % entries.size()]];
+                    p.day = rng() % 6;
+                    p.slot = rng() % 6;
+                    p.room = rng() % 10;
+                }
+                cost -= 1 + rng() % 10;
+                stream.offer(part, entries, placements, cost);
+                // Entries are disjoint between parts, so each part writes its own slice
+                if (round == 399) {
+                    for (int e : entries) finished[e] = placements[e];
+                }
+            }
+        });
+    }
+    for (auto& t : solvers) t.join();
+
+    auto start = std::chrono::steady_clock::now();
+    stream.finish(finished, 42);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    CHECK(seconds < 1.0, "finish() took %.3f s", seconds);
+    done.store(true);
+    consumer.join();
+
+    CHECK(gotFinal, "capacity %zu: final diff not delivered", capacity);
+    int mismatches = 0;
+    for (int e = 0; e < numEntries; ++e) mismatches += !same(state[e], finished[e]);
+    CHECK(mismatches == 0, "capacity %zu: %d entries differ from the finished solution", capacity, mismatches);
+    SnapshotDiff extra;
+    CHECK(!stream.pop(extra), "nothing follows the final diff");
+}
+
+int main() {
+    testQueue();
+    runStream(64, false, 1);
+    runStream(2, false, 2);
+    // A consumer that stalls while the queue is full must not block the final diff
+    runStream(2, true, 3);
+    runStream(64, true, 4);
+    if (failures) {
+        std::printf("stream_test: %d failures\n", failures);
+        return 1;
+    }
+    std::printf("stream_test passed\n");
+    return 0;
+}
@@ -181,7 +181,7 @@ interface ScheduleViewProps {
 
 const ScheduleView: React.FC<ScheduleViewProps> = ({ currentRole, viewDate, setViewDate }) => {
   const store = useStore();
-  const { schedule, groups, teachers, subjects, classrooms, timeSlots, timeSlotsShortened, settings, updateSettings, scheduleTemplates, propagateWeekSchedule, saveCurrentScheduleAsTemplate, loadScheduleFromTemplate, removeScheduleEntries, productionCalendar, departments, teacherSubjectLinks, streams } = store;
+  const { schedule, draftSchedule, groups, teachers, subjects, classrooms, timeSlots, timeSlotsShortened, settings, updateSettings, scheduleTemplates, propagateWeekSchedule, saveCurrentScheduleAsTemplate, loadScheduleFromTemplate, removeScheduleEntries, productionCalendar, departments, teacherSubjectLinks, streams } = store;
   const [filterType, setFilterType] = useState<'group' | 'teacher' | 'classroom'>('group');
   const [selectedId, setSelectedId] = useState<string>(groups[0]?.id || '');
   const [colorBy, setColorBy] = useState<'type' | 'teacher' | 'subject'>('type');
@@ -278,7 +278,8 @@ const ScheduleView: React.FC<ScheduleViewProps> = ({ currentRole, viewDate, setV
         return entry.weekType === 'every' || entry.weekType === effectiveWeekType;
     };
     
-    return schedule.filter(entry => {
+    // Native drafts are drawn on top of the saved schedule while the solver runs
+    return [...schedule, ...draftSchedule].filter(entry => {
       if (!isEntryInCurrentWeek(entry)) return false;
 
       if (filterType === 'group') {
@@ -289,7 +290,7 @@ const ScheduleView: React.FC<ScheduleViewProps> = ({ currentRole, viewDate, setV
       return false;
     });
 
-  }, [schedule, filterType, selectedId, effectiveWeekType, weekStart, weekEnd]);
+  }, [schedule, draftSchedule, filterType, selectedId, effectiveWeekType, weekStart, weekEnd]);
   
   const handleDateSelect = (date: Date) => {
     setViewDate(toYYYYMMDD(date));
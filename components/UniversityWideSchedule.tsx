@@ -41,7 +41,7 @@ const DraggableEntryCell: React.FC<{ entry: ScheduleEntry }> = ({ entry }) => {
 
 
 const UniversityWideSchedule: React.FC<UniversityWideScheduleProps> = ({ setViewDate, setActiveView }) => {
-  const { schedule, groups, subjects, teachers, classrooms, timeSlots, settings, streams, placeItemInGrid, productionCalendar } = useStore();
+  const { schedule, draftSchedule, groups, subjects, teachers, classrooms, timeSlots, settings, streams, placeItemInGrid, productionCalendar } = useStore();
   const [currentDate, setCurrentDate] = useState(toYYYYMMDD(new Date()));
   const [isDatePickerOpen, setIsDatePickerOpen] = useState(false);
   const datePickerRef = useRef<HTMLDivElement>(null);
@@ -82,7 +82,7 @@ const UniversityWideSchedule: React.FC<UniversityWideScheduleProps> = ({ setView
 
   const scheduleMap = useMemo(() => {
     const map = new Map<string, ScheduleEntry>();
-    const relevantSchedule = schedule.filter(entry => {
+    const relevantSchedule = [...schedule, ...draftSchedule].filter(entry => {
         if (entry.date) {
             return entry.date >= weekStart && entry.date <= weekEnd;
         }
@@ -102,7 +102,7 @@ const UniversityWideSchedule: React.FC<UniversityWideScheduleProps> = ({ setView
         });
     });
     return map;
-  }, [schedule, weekStart, weekEnd, effectiveWeekType, weekDays]);
+  }, [schedule, draftSchedule, weekStart, weekEnd, effectiveWeekType, weekDays]);
 
     // Compute set of busy teachers for the current view to perform conflict checking
     const busyTeachers = useMemo(() => {
@@ -254,7 +254,7 @@ const generateUnscheduledEntries = (
 interface StoreState {
   faculties: Faculty[]; departments: Department[]; teachers: Teacher[]; groups: Group[];
   streams: Stream[]; classrooms: Classroom[]; subjects: Subject[]; cabinets: Cabinet[];
-  timeSlots: TimeSlot[]; timeSlotsShortened: TimeSlot[]; schedule: ScheduleEntry[]; unscheduledEntries: UnscheduledEntry[];
+  timeSlots: TimeSlot[]; timeSlotsShortened: TimeSlot[]; schedule: ScheduleEntry[]; draftSchedule: ScheduleEntry[]; unscheduledEntries: UnscheduledEntry[];
   teacherSubjectLinks: TeacherSubjectLink[]; schedulingRules: SchedulingRule[]; 
   productionCalendar: ProductionCalendarEvent[]; settings: SchedulingSettings;
   ugs: UGS[]; specialties: Specialty[]; educationalPlans: EducationalPlan[];
@@ -345,6 +345,8 @@ export const StoreProvider: React.FC<{ children: ReactNode }> = ({ children }) =
   const [timeSlots, setTimeSlots] = useState(initialTimeSlots);
   const [timeSlotsShortened, setTimeSlotsShortened] = useState(initialTimeSlotsShortened);
   const [schedule, setSchedule] = useState<ScheduleEntry[]>(initialSchedule);
+  // Intermediate solutions of the native solver: shown in the grid, never saved
+  const [draftSchedule, setDraftSchedule] = useState<ScheduleEntry[]>([]);
   const [unscheduledEntries, setUnscheduledEntries] = useState<UnscheduledEntry[]>([]);
   const [ugs, setUgs] = useState(initialUGS);
   const [specialties, setSpecialties] = useState(initialSpecialties);
@@ -1204,7 +1206,13 @@ export const StoreProvider: React.FC<{ children: ReactNode }> = ({ children }) =
             };
             result = await runIterativeScheduler(generationData, config, handleProgress);
         } else {
-            result = await generateScheduleWithHeuristics(generationData, config);
+            // Native drafts are overlaid on the grid while the solver works. They live apart from
+            // the schedule, so with clearExisting they simply show on top of entries cleared below.
+            try {
+                result = await generateScheduleWithHeuristics(generationData, config, setDraftSchedule);
+            } finally {
+                setDraftSchedule([]);
+            }
         }
 
         setSchedulingProgress(null);
@@ -1369,7 +1377,7 @@ export const StoreProvider: React.FC<{ children: ReactNode }> = ({ children }) =
 
 
   const value: StoreState = {
-    faculties, departments, teachers, groups, streams, classrooms, subjects, cabinets, timeSlots, timeSlotsShortened, schedule, unscheduledEntries,
+    faculties, departments, teachers, groups, streams, classrooms, subjects, cabinets, timeSlots, timeSlotsShortened, schedule, draftSchedule, unscheduledEntries,
     teacherSubjectLinks, schedulingRules, productionCalendar, settings, ugs, specialties, educationalPlans, scheduleTemplates,
     classroomTypes, classroomTags, isGeminiAvailable, subgroups, electives, currentFilePath, lastAutosave, apiKey, openRouterApiKey, unscheduledTimeHorizon,
     schedulingProgress, viewDate,
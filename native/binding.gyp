@@ -23,7 +23,7 @@
           "ldflags": [ "-fopenmp" ]
         }]
       ],
-      "sources": [ "scheduler.cc", "scheduler_wrapper.cc" ],
+      "sources": [ "scheduler.cc", "problem_buffer.cc", "problem_snapshot.cc", "scheduler_wrapper.cc" ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")"
       ],
@@ -0,0 +1,402 @@
+#include "problem_buffer.h"
+#include <cstring>
+
+namespace {
+
+const char kProblemMagic[4] = { 'S', 'P', 'R', 'B' };
+const char kConfigMagic[4] = { 'S', 'C', 'F', 'G' };
+const char kResultMagic[4] = { 'S', 'R', 'E', 'S' };
+
+class BufferWriter {
+public:
+    std::vector<uint8_t> bytes;
+
+    void magic(const char (&m)[4], uint32_t version) {
+        bytes.insert(bytes.end(), m, m + 4);
+        u32(version);
+    }
+    void u8(uint8_t v) { bytes.push_back(v); }
+    void boolean(bool v) { u8(v ? 1 : 0); }
+    void u32(uint32_t v) {
+        for (int i = 0; i < 4; ++i) bytes.push_back((uint8_t)(v >> (8 * i)));
+    }
+    void i32(int32_t v) { u32((uint32_t)v); }
+    void f64(double v) {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        for (int i = 0; i < 8; ++i) bytes.push_back((uint8_t)(bits >> (8 * i)));
+    }
+    void str(const std::string& s) {
+        u32((uint32_t)s.size());
+        bytes.insert(bytes.end(), s.begin(), s.end());
+    }
+    void strs(const std::vector<std::string>& list) {
+        u32((uint32_t)list.size());
+        for (const auto& s : list) str(s);
+    }
+};
+
+// Bounds-checked reader; after the first failure every read returns zero values
+class BufferReader {
+public:
+    BufferReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    bool ok() const { return ok_; }
+    bool atEnd() const { return pos_ == size_; }
+    const std::string& error() const { return error_; }
+
+    void fail(const std::string& message) {
+        if (ok_) error_ = message + " at byte " + std::to_string(pos_);
+        ok_ = false;
+    }
+
+    bool magic(const char (&m)[4], uint32_t version) {
+        if (!take(4) || std::memcmp(data_ + pos_ - 4, m, 4) != 0) {
+            fail("bad magic");
+            return false;
+        }
+        uint32_t v = u32();
+        if (ok_ && v != version) fail("unsupported version " + std::to_string(v));
+        return ok_;
+    }
+    uint8_t u8() { return take(1) ? data_[pos_ - 1] : 0; }
+    bool boolean() { return u8() != 0; }
+    uint32_t u32() {
+        if (!take(4)) return 0;
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) v |= (uint32_t)data_[pos_ - 4 + i] << (8 * i);
+        return v;
+    }
+    int32_t i32() { return (int32_t)u32(); }
+    double f64() {
+        if (!take(8)) return 0;
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i) bits |= (uint64_t)data_[pos_ - 8 + i] << (8 * i);
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    std::string str() {
+        uint32_t len = u32();
+        if (!take(len)) return std::string();
+        return std::string((const char*)data_ + pos_ - len, len);
+    }
+    // Element count; every element takes at least one byte, so larger counts are corrupt
+    uint32_t count() {
+        uint32_t n = u32();
+        if (ok_ && n > size_ - pos_) {
+            fail("list length out of range");
+            return 0;
+        }
+        return n;
+    }
+    std::vector<std::string> strs() {
+        std::vector<std::string> list(count());
+        for (auto& s : list) s = str();
+        return list;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+    std::string error_;
+
+    bool take(size_t n) {
+        if (!ok_) return false;
+        if (n > size_ - pos_) {
+            fail("unexpected end of buffer");
+            return false;
+        }
+        pos_ += n;
+        return true;
+    }
+};
+
+void writeGrid(BufferWriter& w, const AvailabilityGrid& grid) {
+    w.u32((uint32_t)grid.grid.size());
+    for (const auto& day : grid.grid) {
+        w.str(day.first);
+        w.u32((uint32_t)day.second.size());
+        for (const auto& slot : day.second) {
+            w.str(slot.first);
+            w.u8((uint8_t)slot.second);
+        }
+    }
+}
+
+AvailabilityGrid readGrid(BufferReader& r) {
+    AvailabilityGrid grid;
+    uint32_t days = r.count();
+    for (uint32_t d = 0; d < days && r.ok(); ++d) {
+        std::string day = r.str();
+        uint32_t slots = r.count();
+        for (uint32_t s = 0; s < slots && r.ok(); ++s) {
+            std::string slot = r.str();
+            uint8_t type = r.u8();
+            if (type > (uint8_t)AvailabilityType::Forbidden) r.fail("bad availability type");
+            grid.grid[day][slot] = static_cast<AvailabilityType>(type);
+        }
+    }
+    return grid;
+}
+
+} // namespace
+
+std::vector<uint8_t> encodeProblem(const Problem& problem) {
+    BufferWriter w;
+    w.magic(kProblemMagic, kProblemBufferVersion);
+
+    w.u32((uint32_t)problem.teachers.size());
+    for (const auto& t : problem.teachers) {
+        w.str(t.id);
+        w.str(t.name);
+        w.str(t.pinnedClassroomId);
+        writeGrid(w, t.availabilityGrid);
+    }
+
+    w.u32((uint32_t)problem.groups.size());
+    for (const auto& g : problem.groups) {
+        w.str(g.id);
+        w.str(g.name);
+        w.i32(g.studentCount);
+        w.i32(g.course);
+        w.str(g.pinnedClassroomId);
+        writeGrid(w, g.availabilityGrid);
+    }
+
+    w.u32((uint32_t)problem.classrooms.size());
+    for (const auto& c : problem.classrooms) {
+        w.str(c.id);
+        w.str(c.name);
+        w.i32(c.capacity);
+        w.str(c.typeId);
+        w.strs(c.tagIds);
+    }
+
+    w.u32((uint32_t)problem.subjects.size());
+    for (const auto& s : problem.subjects) {
+        w.str(s.id);
+        w.str(s.name);
+        w.str(s.pinnedClassroomId);
+        w.strs(s.requiredClassroomTagIds);
+        w.u32((uint32_t)s.classroomTypeRequirements.size());
+        for (const auto& req : s.classroomTypeRequirements) {
+            w.str(req.first);
+            w.strs(req.second);
+        }
+    }
+
+    w.u32((uint32_t)problem.timeSlots.size());
+    for (const auto& ts : problem.timeSlots) {
+        w.str(ts.id);
+        w.str(ts.name);
+        w.i32(ts.order);
+    }
+
+    w.u32((uint32_t)problem.entries.size());
+    for (const auto& e : problem.entries) {
+        w.str(e.uid);
+        w.str(e.subjectId);
+        w.str(e.teacherId);
+        w.str(e.classType);
+        w.i32(e.studentCount);
+        w.strs(e.groupIds);
+    }
+
+    return w.bytes;
+}
+
+bool decodeProblem(const uint8_t* data, size_t size, Problem& problem, std::string& error) {
+    BufferReader r(data, size);
+    problem = Problem();
+    if (r.magic(kProblemMagic, kProblemBufferVersion)) {
+        problem.teachers.resize(r.count());
+        for (auto& t : problem.teachers) {
+            t.id = r.str();
+            t.name = r.str();
+            t.pinnedClassroomId = r.str();
+            t.availabilityGrid = readGrid(r);
+        }
+
+        problem.groups.resize(r.count());
+        for (auto& g : problem.groups) {
+            g.id = r.str();
+            g.name = r.str();
+            g.studentCount = r.i32();
+            g.course = r.i32();
+            g.pinnedClassroomId = r.str();
+            g.availabilityGrid = readGrid(r);
+        }
+
+        problem.classrooms.resize(r.count());
+        for (auto& c : problem.classrooms) {
+            c.id = r.str();
+            c.name = r.str();
+            c.capacity = r.i32();
+            c.typeId = r.str();
+            c.tagIds = r.strs();
+        }
+
+        problem.subjects.resize(r.count());
+        for (auto& s : problem.subjects) {
+            s.id = r.str();
+            s.name = r.str();
+            s.pinnedClassroomId = r.str();
+            s.requiredClassroomTagIds = r.strs();
+            uint32_t reqs = r.count();
+            for (uint32_t k = 0; k < reqs && r.ok(); ++k) {
+                std::string classType = r.str();
+                s.classroomTypeRequirements[classType] = r.strs();
+            }
+        }
+
+        problem.timeSlots.resize(r.count());
+        for (auto& ts : problem.timeSlots) {
+            ts.id = r.str();
+            ts.name = r.str();
+            ts.order = r.i32();
+        }
+
+        problem.entries.resize(r.count());
+        for (auto& e : problem.entries) {
+            e.uid = r.str();
+            e.subjectId = r.str();
+            e.teacherId = r.str();
+            e.classType = r.str();
+            e.studentCount = r.i32();
+            e.groupIds = r.strs();
+        }
+
+        if (r.ok() && !r.atEnd()) r.fail("trailing bytes");
+    }
+
+    if (!r.ok()) error = "problem buffer: " + r.error();
+    return r.ok();
+}
+
+std::vector<uint8_t> encodeConfig(const Config& config) {
+    BufferWriter w;
+    w.magic(kConfigMagic, kConfigBufferVersion);
+
+    w.i32(config.strictness);
+    w.boolean(config.settings.allowWindows);
+    w.boolean(config.settings.enforceStandardRules);
+    w.boolean(config.settings.respectProductionCalendar);
+    w.boolean(config.settings.useShortenedPreHolidaySchedule);
+    w.boolean(config.enforceLectureOrder);
+    w.boolean(config.distributeEvenly);
+    w.f64(config.timeLimitSeconds);
+
+    w.boolean(config.lns.enabled);
+    w.i32(config.lns.iterations);
+    w.i32(config.lns.parallelRepairs);
+    w.f64(config.lns.destroyFraction);
+    w.u8((uint8_t)config.lns.acceptance);
+    w.f64(config.lns.recordDeviation);
+
+    w.boolean(config.decomposition.enabled);
+    w.f64(config.decomposition.maxRoomOverlap);
+
+    w.u32((uint32_t)config.schedulingRules.size());
+    for (const auto& rule : config.schedulingRules) {
+        w.str(rule.id);
+        w.i32((int32_t)rule.action);
+        w.i32((int32_t)rule.severity);
+        w.str(rule.day);
+        w.str(rule.timeSlotId);
+        w.i32(rule.param);
+        w.u32((uint32_t)rule.conditions.size());
+        for (const auto& cond : rule.conditions) {
+            w.str(cond.entityType);
+            w.strs(cond.entityIds);
+            w.str(cond.classType);
+        }
+    }
+
+    return w.bytes;
+}
+
+bool decodeConfig(const uint8_t* data, size_t size, Config& config, std::string& error) {
+    BufferReader r(data, size);
+    config = Config();
+    if (r.magic(kConfigMagic, kConfigBufferVersion)) {
+        config.strictness = r.i32();
+        config.settings.allowWindows = r.boolean();
+        config.settings.enforceStandardRules = r.boolean();
+        config.settings.respectProductionCalendar = r.boolean();
+        config.settings.useShortenedPreHolidaySchedule = r.boolean();
+        config.enforceLectureOrder = r.boolean();
+        config.distributeEvenly = r.boolean();
+        config.timeLimitSeconds = r.f64();
+
+        config.lns.enabled = r.boolean();
+        config.lns.iterations = r.i32();
+        config.lns.parallelRepairs = r.i32();
+        config.lns.destroyFraction = r.f64();
+        uint8_t acceptance = r.u8();
+        if (acceptance > (uint8_t)LnsAcceptance::RecordToRecord) r.fail("bad LNS acceptance");
+        config.lns.acceptance = static_cast<LnsAcceptance>(acceptance);
+        config.lns.recordDeviation = r.f64();
+
+        config.decomposition.enabled = r.boolean();
+        config.decomposition.maxRoomOverlap = r.f64();
+
+        config.schedulingRules.resize(r.count());
+        for (auto& rule : config.schedulingRules) {
+            rule.id = r.str();
+            rule.action = static_cast<RuleAction>(r.i32());
+            rule.severity = static_cast<RuleSeverity>(r.i32());
+            rule.day = r.str();
+            rule.timeSlotId = r.str();
+            rule.param = r.i32();
+            rule.conditions.resize(r.count());
+            for (auto& cond : rule.conditions) {
+                cond.entityType = r.str();
+                cond.entityIds = r.strs();
+                cond.classType = r.str();
+            }
+        }
+
+        if (r.ok() && !r.atEnd()) r.fail("trailing bytes");
+        std::string invalid;
+        if (r.ok() && !validateConfig(config, invalid)) r.fail(invalid);
+    }
+
+    if (!r.ok()) error = "config buffer: " + r.error();
+    return r.ok();
+}
+
+std::vector<uint8_t> encodeResults(const std::vector<ScenarioResult>& results) {
+    BufferWriter w;
+    w.magic(kResultMagic, kResultBufferVersion);
+
+    w.u32((uint32_t)results.size());
+    for (const auto& result : results) {
+        w.f64(result.cost.hardConflicts);
+        w.f64(result.cost.availability);
+        w.f64(result.cost.pinnedRooms);
+        w.f64(result.cost.dailyLoad);
+        w.f64(result.cost.distribution);
+        w.f64(result.cost.rules);
+        w.f64(result.cost.total);
+        w.i32(result.unscheduled);
+        w.f64(result.seconds);
+
+        w.u32((uint32_t)result.schedule.size());
+        for (const auto& e : result.schedule) {
+            w.str(e.id);
+            w.str(e.day);
+            w.str(e.timeSlotId);
+            w.str(e.classroomId);
+            w.str(e.subjectId);
+            w.str(e.teacherId);
+            w.str(e.classType);
+            w.str(e.unscheduledUid);
+            w.strs(e.groupIds);
+        }
+    }
+
+    return w.bytes;
+}
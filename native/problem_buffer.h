@@ -0,0 +1,60 @@
+#ifndef PROBLEM_BUFFER_H
+#define PROBLEM_BUFFER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "scheduler.h"
+
+// Binary buffer format for problems, configs and results.
+// Used by the C ABI library (ORBCS/Scheduler) so non-Node tools can talk to the solver.
+//
+// All integers are little-endian. Every buffer starts with a 4-byte magic and a u32 version.
+//   str     = u32 byteLength, UTF-8 bytes
+//   list<T> = u32 count, T...
+//   bool    = u8 (0/1)
+//
+// Problem ("SPRB"):
+//   list<Teacher>   Teacher   = str id, str name, str pinnedClassroomId, grid
+//   list<Group>     Group     = str id, str name, i32 studentCount, i32 course, str pinnedClassroomId, grid
+//   list<Classroom> Classroom = str id, str name, i32 capacity, str typeId, list<str> tagIds
+//   list<Subject>   Subject   = str id, str name, str pinnedClassroomId, list<str> requiredClassroomTagIds,
+//                               list<(str classType, list<str> roomTypeIds)> classroomTypeRequirements
+//   list<TimeSlot>  TimeSlot  = str id, str name, i32 order
+//   list<Entry>     Entry     = str uid, str subjectId, str teacherId, str classType, i32 studentCount,
+//                               list<str> groupIds
+//   grid = list<(str day, list<(str timeSlotId, u8 AvailabilityType)>)>
+//
+// Config ("SCFG"):
+//   i32 strictness, bool allowWindows, bool enforceStandardRules, bool respectProductionCalendar,
+//   bool useShortenedPreHolidaySchedule, bool enforceLectureOrder, bool distributeEvenly,
+//   f64 timeLimitSeconds,
+//   bool lns.enabled, i32 lns.iterations, i32 lns.parallelRepairs, f64 lns.destroyFraction,
+//   u8 lns.acceptance, f64 lns.recordDeviation,
+//   bool decomposition.enabled, f64 decomposition.maxRoomOverlap,
+//   list<Rule> Rule = str id, i32 action, i32 severity, str day, str timeSlotId, i32 param,
+//                     list<(str entityType, list<str> entityIds, str classType)> conditions
+//   action and severity are RuleAction / RuleSeverity values. Decoded configs must pass
+//   validateConfig() (numeric ranges, supported rules), otherwise decoding fails.
+//
+// Results ("SRES"):
+//   list<Scenario> Scenario = f64 hardConflicts, f64 availability, f64 pinnedRooms, f64 dailyLoad,
+//                             f64 distribution, f64 rules, f64 total, i32 unscheduled, f64 seconds,
+//                             list<ScheduleEntry>
+//   ScheduleEntry = str id, str day, str timeSlotId, str classroomId, str subjectId, str teacherId,
+//                   str classType, str unscheduledUid, list<str> groupIds
+
+const uint32_t kProblemBufferVersion = 1;
+const uint32_t kConfigBufferVersion = 1;
+const uint32_t kResultBufferVersion = 2;
+
+std::vector<uint8_t> encodeProblem(const Problem& problem);
+bool decodeProblem(const uint8_t* data, size_t size, Problem& problem, std::string& error);
+
+std::vector<uint8_t> encodeConfig(const Config& config);
+bool decodeConfig(const uint8_t* data, size_t size, Config& config, std::string& error);
+
+std::vector<uint8_t> encodeResults(const std::vector<ScenarioResult>& results);
+
+#endif // PROBLEM_BUFFER_H
@@ -0,0 +1,657 @@
+#include "problem_snapshot.h"
+#include "scheduler.h"
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+uint64_t hashProblemBuffer(const uint8_t* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t hashRules(const Config& config) {
+    // Length-prefixed fields, so that no two rule sets serialize alike
+    std::vector<uint8_t> bytes;
+    auto putInt = [&](int64_t v) {
+        const uint8_t* raw = reinterpret_cast<const uint8_t*>(&v);
+        bytes.insert(bytes.end(), raw, raw + sizeof(v));
+    };
+    auto putStr = [&](const std::string& str) {
+        putInt(str.size());
+        bytes.insert(bytes.end(), str.begin(), str.end());
+    };
+    putInt(config.strictness);
+    putInt(config.schedulingRules.size());
+    for (const auto& rule : config.schedulingRules) {
+        putInt((int)rule.action);
+        putInt((int)rule.severity);
+        putStr(rule.day);
+        putStr(rule.timeSlotId);
+        putInt(rule.param);
+        putInt(rule.conditions.size());
+        for (const auto& condition : rule.conditions) {
+            putStr(condition.entityType);
+            putStr(condition.classType);
+            putInt(condition.entityIds.size());
+            for (const auto& id : condition.entityIds) putStr(id);
+        }
+    }
+    return hashProblemBuffer(bytes.data(), bytes.size());
+}
+
+// --- MappedFile ---
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path, std::string& error) {
+    close();
+    int wideLength = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+    std::wstring widePath(wideLength > 0 ? wideLength : 0, L'\0');
+    if (wideLength > 0) MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &widePath[0], wideLength);
+
+    HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error = "cannot open " + path;
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        error = "empty or unreadable file " + path;
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        error = "cannot map " + path;
+        return false;
+    }
+    file_ = file;
+    mapping_ = mapping;
+    data_ = static_cast<const uint8_t*>(view);
+    size_ = (size_t)size.QuadPart;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_) CloseHandle(file_);
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = nullptr;
+    size_ = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path, std::string& error) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        error = "empty or unreadable file " + path;
+        return false;
+    }
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file referenced
+    if (view == MAP_FAILED) {
+        error = "cannot map " + path;
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(view);
+    size_ = (size_t)st.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+#endif
+
+namespace {
+
+const char kSnapshotMagic[4] = { 'S', 'S', 'N', 'P' };
+const size_t kHeaderSize = 24;
+const size_t kSectionEntrySize = 24;
+
+enum SectionId : uint32_t {
+    StringIndex = 1,     // u32 (offset, length) per string
+    StringData,          // UTF-8 bytes
+    TeacherIds,          // u32 string ids
+    GroupIds,
+    ClassroomIds,
+    SubjectIds,
+    TimeSlotIds,
+    DayNames,
+    EntryStrings,        // u32 x4 per entry: uid, subjectId, teacherId, classType
+    EntryGroupIdOffsets, // CSR over EntryGroupIdStrings (raw groupIds, unknown ids included)
+    EntryGroupIdStrings,
+    EntryStudents,       // i32 per entry
+    TeacherAvail,        // i8 [teacher][day][slot]
+    GroupAvail,          // i8 [group][day][slot]
+    TeacherPins,         // i32 classroom index or -1
+    GroupPins,
+    SubjectPins,
+    EntrySignatures,     // i32 room signature per entry
+    SignatureOffsets,    // CSR [signature] -> classroom indices
+    SignatureRooms,
+    EntryTeachers,       // i32 per entry, -1 if unknown
+    EntrySubjects,
+    EntryGroupOffsets,   // CSR [entry] -> group indices
+    EntryGroups,
+    TeacherEntryOffsets, // CSR [teacher] -> entry indices
+    TeacherEntries,
+    GroupEntryOffsets,   // CSR [group] -> entry indices
+    GroupEntries,
+    ClassroomTypes,      // i32 per classroom
+    Scalars,             // i32: numRoomTypes, saturday
+    EntryKinds,          // i32 DistributionTracker::EntryKind per entry
+    RulesHash,           // u64 hashRules() of the config the rules below were compiled for
+    RuleActions,         // i32 RuleAction per compiled rule
+    RuleCells,           // i32 per compiled rule
+    RuleParams,          // i32 per compiled rule
+    RulePenalties,       // f64 per compiled rule
+    RuleApplies,         // u8 [rule * numEntries + entry]
+    RuleKeyOffsets,      // CSR [rule * numEntries + entry] -> MaxPerDay keys
+    RuleKeys
+};
+
+static_assert(sizeof(int) == sizeof(int32_t), "index sections are read in place as int");
+
+class SnapshotWriter {
+public:
+    template <typename T>
+    void section(uint32_t id, const std::vector<T>& values) {
+        Section s;
+        s.id = id;
+        s.elementSize = sizeof(T);
+        s.count = values.size();
+        s.bytes.resize(values.size() * sizeof(T));
+        if (!values.empty()) std::memcpy(s.bytes.data(), values.data(), s.bytes.size());
+        sections_.push_back(std::move(s));
+    }
+
+    uint32_t intern(const std::string& s) {
+        auto it = stringIds_.find(s);
+        if (it != stringIds_.end()) return it->second;
+        uint32_t id = stringIndex_.size() / 2;
+        stringIndex_.push_back(stringData_.size());
+        stringIndex_.push_back(s.size());
+        stringData_.insert(stringData_.end(), s.begin(), s.end());
+        stringIds_.emplace(s, id);
+        return id;
+    }
+
+    void csr(uint32_t offsetsId, uint32_t valuesId, const IndexLists& lists) {
+        section(offsetsId, std::vector<uint32_t>(lists.offsets().begin(), lists.offsets().end()));
+        section(valuesId, std::vector<int32_t>(lists.values().begin(), lists.values().end()));
+    }
+
+    bool write(const std::string& path, uint64_t sourceHash, std::string& error) {
+        section(StringIndex, stringIndex_);
+        section(StringData, stringData_);
+
+        std::vector<uint8_t> out(kHeaderSize + sections_.size() * kSectionEntrySize, 0);
+        std::memcpy(out.data(), kSnapshotMagic, 4);
+        put32(out, 4, kSnapshotVersion);
+        put64(out, 8, sourceHash);
+        put32(out, 16, sections_.size());
+        for (size_t k = 0; k < sections_.size(); ++k) {
+            while (out.size() % 8) out.push_back(0);
+            size_t entry = kHeaderSize + k * kSectionEntrySize;
+            put32(out, entry, sections_[k].id);
+            put32(out, entry + 4, sections_[k].elementSize);
+            put64(out, entry + 8, out.size());
+            put64(out, entry + 16, sections_[k].count);
+            out.insert(out.end(), sections_[k].bytes.begin(), sections_[k].bytes.end());
+        }
+
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            error = "cannot write " + path;
+            return false;
+        }
+        bool ok = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+        ok = std::fclose(file) == 0 && ok;
+        if (!ok) error = "cannot write " + path;
+        return ok;
+    }
+
+private:
+    struct Section {
+        uint32_t id;
+        uint32_t elementSize;
+        uint64_t count;
+        std::vector<uint8_t> bytes;
+    };
+    std::vector<Section> sections_;
+    std::vector<uint32_t> stringIndex_;
+    std::vector<char> stringData_;
+    std::unordered_map<std::string, uint32_t> stringIds_;
+
+    static void put32(std::vector<uint8_t>& out, size_t pos, uint32_t v) { std::memcpy(&out[pos], &v, 4); }
+    static void put64(std::vector<uint8_t>& out, size_t pos, uint64_t v) { std::memcpy(&out[pos], &v, 8); }
+};
+
+// Validating view over a mapped snapshot; after the first failure every lookup fails
+class SnapshotReader {
+public:
+    bool open(const uint8_t* data, size_t size, uint64_t sourceHash) {
+        data_ = data;
+        size_ = size;
+        if (size < kHeaderSize || std::memcmp(data, kSnapshotMagic, 4) != 0) return fail("not a problem snapshot");
+        uint32_t version = get32(4);
+        if (version != kSnapshotVersion) return fail("unsupported snapshot version " + std::to_string(version));
+        if (get64(8) != sourceHash) return fail("stale snapshot: source data hash mismatch");
+        count_ = get32(16);
+        if (count_ > (size - kHeaderSize) / kSectionEntrySize) return fail("truncated section table");
+        for (size_t k = 0; k < count_; ++k) {
+            size_t entry = kHeaderSize + k * kSectionEntrySize;
+            uint64_t offset = get64(entry + 8);
+            uint64_t count = get64(entry + 16);
+            uint32_t elementSize = get32(entry + 4);
+            if (elementSize == 0 || offset % 8 != 0 || offset > size ||
+                count > (size - offset) / elementSize) {
+                return fail("section " + std::to_string(get32(entry)) + " out of bounds");
+            }
+        }
+        return true;
+    }
+
+    bool ok() const { return ok_; }
+    const std::string& error() const { return error_; }
+
+    bool fail(const std::string& message) {
+        if (ok_) error_ = message;
+        ok_ = false;
+        return false;
+    }
+
+    // Section contents; sections are 8-byte aligned in a page-aligned mapping
+    template <typename T>
+    const T* get(uint32_t id, size_t& count) {
+        count = 0;
+        if (!ok_) return nullptr;
+        for (size_t k = 0; k < count_; ++k) {
+            size_t entry = kHeaderSize + k * kSectionEntrySize;
+            if (get32(entry) != id) continue;
+            if (get32(entry + 4) != sizeof(T)) {
+                fail("section " + std::to_string(id) + " has unexpected element size");
+                return nullptr;
+            }
+            count = get64(entry + 16);
+            return reinterpret_cast<const T*>(data_ + get64(entry + 8));
+        }
+        fail("missing section " + std::to_string(id));
+        return nullptr;
+    }
+
+    template <typename T>
+    bool array(uint32_t id, size_t expected, std::vector<T>& out) {
+        size_t count;
+        const T* values = get<T>(id, count);
+        if (!ok_) return false;
+        if (count != expected) return fail("section " + std::to_string(id) + " has wrong length");
+        out.assign(values, values + count);
+        return true;
+    }
+
+    // Index arrays must point inside their target ([lo, hi))
+    bool indices(uint32_t id, size_t expected, int lo, int hi, std::vector<int>& out) {
+        if (!array(id, expected, out)) return false;
+        for (int v : out) {
+            if (v < lo || v >= hi) return fail("section " + std::to_string(id) + " has an index out of range");
+        }
+        return true;
+    }
+
+    // A section used in place; `owner` keeps the mapping alive
+    template <typename T>
+    bool shared(uint32_t id, size_t expected, const std::shared_ptr<const void>& owner, SharedArray<T>& out) {
+        size_t count;
+        const T* values = get<T>(id, count);
+        if (!ok_) return false;
+        if (count != expected) return fail("section " + std::to_string(id) + " has wrong length");
+        out = SharedArray<T>(owner, values, count);
+        return true;
+    }
+
+    // CSR lists used in place: offsets must be monotonic, values inside [0, hi)
+    bool csr(uint32_t offsetsId, uint32_t valuesId, size_t lists, int hi,
+               const std::shared_ptr<const void>& owner, IndexLists& out) {
+        size_t numOffsets, numValues;
+        const uint32_t* offsets = get<uint32_t>(offsetsId, numOffsets);
+        const int* values = get<int>(valuesId, numValues);
+        if (!ok_) return false;
+        if (numOffsets != lists + 1 || offsets[0] != 0 || offsets[lists] != numValues) {
+            return fail("section " + std::to_string(offsetsId) + " is inconsistent");
+        }
+        for (size_t i = 0; i < lists; ++i) {
+            if (offsets[i + 1] < offsets[i]) return fail("section " + std::to_string(offsetsId) + " is inconsistent");
+        }
+        for (size_t k = 0; k < numValues; ++k) {
+            if (values[k] < 0 || values[k] >= hi) return fail("section " + std::to_string(valuesId) + " has an index out of range");
+        }
+        out = IndexLists(SharedArray<uint32_t>(owner, offsets, numOffsets), SharedArray<int>(owner, values, numValues));
+        return true;
+    }
+
+    bool loadStrings() {
+        index_ = get<uint32_t>(StringIndex, numStrings_);
+        chars_ = get<char>(StringData, numChars_);
+        if (!ok_) return false;
+        numStrings_ /= 2;
+        for (size_t i = 0; i < numStrings_; ++i) {
+            if (index_[2 * i] > numChars_ || index_[2 * i + 1] > numChars_ - index_[2 * i]) {
+                return fail("string table out of bounds");
+            }
+        }
+        return true;
+    }
+
+    std::string str(uint32_t id) {
+        if (id >= numStrings_) {
+            fail("string id out of range");
+            return std::string();
+        }
+        return std::string(chars_ + index_[2 * id], index_[2 * id + 1]);
+    }
+
+    std::vector<std::string> strs(uint32_t id, size_t expected) {
+        std::vector<uint32_t> ids;
+        std::vector<std::string> out;
+        if (!array(id, expected, ids)) return out;
+        out.reserve(ids.size());
+        for (uint32_t s : ids) out.push_back(str(s));
+        return out;
+    }
+
+    // Element count of a section, 0 if it is missing
+    size_t count(uint32_t id) const {
+        for (size_t k = 0; k < count_; ++k) {
+            size_t entry = kHeaderSize + k * kSectionEntrySize;
+            if (get32(entry) == id) return get64(entry + 16);
+        }
+        return 0;
+    }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t count_ = 0;
+    const uint32_t* index_ = nullptr;
+    const char* chars_ = nullptr;
+    size_t numStrings_ = 0;
+    size_t numChars_ = 0;
+    bool ok_ = true;
+    std::string error_;
+
+    uint32_t get32(size_t pos) const { uint32_t v; std::memcpy(&v, data_ + pos, 4); return v; }
+    uint64_t get64(size_t pos) const { uint64_t v; std::memcpy(&v, data_ + pos, 8); return v; }
+};
+
+template <typename Entity>
+std::vector<uint32_t> internIds(SnapshotWriter& writer, const std::vector<Entity>& items) {
+    std::vector<uint32_t> ids;
+    for (const auto& item : items) ids.push_back(writer.intern(item.id));
+    return ids;
+}
+
+} // namespace
+
+bool Scheduler::saveSnapshot(const std::string& path, uint64_t sourceHash, std::string& error) const {
+    return saveSnapshot(path, sourceHash, config_, error);
+}
+
+bool Scheduler::saveSnapshot(const std::string& path, uint64_t sourceHash, const Config& rulesConfig,
+                             std::string& error) const {
+    SnapshotWriter writer;
+    writer.section(TeacherIds, internIds(writer, teachers_));
+    writer.section(GroupIds, internIds(writer, groups_));
+    writer.section(ClassroomIds, internIds(writer, classrooms_));
+    writer.section(SubjectIds, internIds(writer, subjects_));
+    writer.section(TimeSlotIds, internIds(writer, timeSlots_));
+    std::vector<uint32_t> days;
+    for (const auto& d : workDays_) days.push_back(writer.intern(d));
+    writer.section(DayNames, days);
+
+    std::vector<uint32_t> entryStrings;
+    std::vector<uint32_t> groupIdOffsets(1, 0);
+    std::vector<uint32_t> groupIdStrings;
+    std::vector<int32_t> students;
+    for (const auto& e : entries_) {
+        entryStrings.push_back(writer.intern(e.uid));
+        entryStrings.push_back(writer.intern(e.subjectId));
+        entryStrings.push_back(writer.intern(e.teacherId));
+        entryStrings.push_back(writer.intern(e.classType));
+        for (const auto& gid : e.groupIds) groupIdStrings.push_back(writer.intern(gid));
+        groupIdOffsets.push_back(groupIdStrings.size());
+        students.push_back(e.studentCount);
+    }
+    writer.section(EntryStrings, entryStrings);
+    writer.section(EntryGroupIdOffsets, groupIdOffsets);
+    writer.section(EntryGroupIdStrings, groupIdStrings);
+    writer.section(EntryStudents, students);
+
+    writer.section(TeacherAvail, std::vector<int8_t>(fastTeacherAvail_.begin(), fastTeacherAvail_.end()));
+    writer.section(GroupAvail, std::vector<int8_t>(fastGroupAvail_.begin(), fastGroupAvail_.end()));
+    writer.section(TeacherPins, fastTeacherPin_);
+    writer.section(GroupPins, fastGroupPin_);
+    writer.section(SubjectPins, fastSubjectPin_);
+    writer.section(EntrySignatures, entrySignature_);
+    writer.csr(SignatureOffsets, SignatureRooms, signatureRooms_);
+    writer.section(EntryTeachers, entryTeacher_);
+    writer.section(EntrySubjects, entrySubject_);
+    writer.csr(EntryGroupOffsets, EntryGroups, entryGroups_);
+    writer.csr(TeacherEntryOffsets, TeacherEntries, teacherEntries_);
+    writer.csr(GroupEntryOffsets, GroupEntries, groupEntries_);
+    writer.section(ClassroomTypes, classroomType_);
+    writer.section(Scalars, std::vector<int32_t>{ numRoomTypes_, distributionModel_.saturday });
+    writer.section(EntryKinds, distributionModel_.entryKind);
+
+    // Rules compiled as solve() would, for the config they were compiled for
+    std::vector<CompiledRule> rules = compileRules(rulesConfig);
+    std::vector<int32_t> actions, cells, params;
+    std::vector<double> penalties;
+    std::vector<uint8_t> applies;
+    std::vector<uint32_t> keyOffsets(1, 0);
+    std::vector<int32_t> keys;
+    for (const CompiledRule& rule : rules) {
+        actions.push_back((int)rule.action);
+        cells.push_back(rule.cell);
+        params.push_back(rule.param);
+        penalties.push_back(rule.penalty);
+        applies.insert(applies.end(), rule.applies.begin(), rule.applies.end());
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            if (rule.keys.size()) {
+                IndexRange list = rule.keys[i];
+                keys.insert(keys.end(), list.begin(), list.end());
+            }
+            keyOffsets.push_back(keys.size());
+        }
+    }
+    writer.section(RulesHash, std::vector<uint64_t>{ hashRules(rulesConfig) });
+    writer.section(RuleActions, actions);
+    writer.section(RuleCells, cells);
+    writer.section(RuleParams, params);
+    writer.section(RulePenalties, penalties);
+    writer.section(RuleApplies, applies);
+    writer.section(RuleKeyOffsets, keyOffsets);
+    writer.section(RuleKeys, keys);
+
+    return writer.write(path, sourceHash, error);
+}
+
+bool Scheduler::loadSnapshot(const std::string& path, uint64_t sourceHash, const Config& config, std::string& error) {
+    // The flat tables and lists below point into the mapping, which lives as long as they do
+    auto mapped = std::make_shared<MappedFile>();
+    MappedFile& file = *mapped;
+    if (!file.open(path, error)) return false;
+    std::shared_ptr<const void> owner = mapped;
+    // Decoded aside and moved in only once every section checks out, so a bad
+    // snapshot leaves the current problem untouched
+    Scheduler loaded;
+    SnapshotReader r;
+    if (!r.open(file.data(), file.size(), sourceHash) || !r.loadStrings()) {
+        error = r.error();
+        return false;
+    }
+
+    // Entities keep only their ids: everything else lives in the flat tables below
+    auto restore = [&](uint32_t id, auto& items) {
+        std::vector<std::string> ids = r.strs(id, r.count(id));
+        items.assign(ids.size(), typename std::decay<decltype(items)>::type::value_type());
+        for (size_t i = 0; i < ids.size(); ++i) items[i].id = ids[i];
+    };
+    restore(TeacherIds, loaded.teachers_);
+    restore(GroupIds, loaded.groups_);
+    restore(ClassroomIds, loaded.classrooms_);
+    restore(SubjectIds, loaded.subjects_);
+    restore(TimeSlotIds, loaded.timeSlots_);
+    for (size_t i = 0; i < loaded.timeSlots_.size(); ++i) loaded.timeSlots_[i].order = i;
+    loaded.workDays_ = r.strs(DayNames, r.count(DayNames));
+
+    size_t numTeachers = loaded.teachers_.size(), numGroups = loaded.groups_.size(), numRooms = loaded.classrooms_.size();
+    size_t numSubjects = loaded.subjects_.size(), numDays = loaded.workDays_.size(), numSlots = loaded.timeSlots_.size();
+    size_t n = r.count(EntryStudents);
+    if (!r.ok()) {
+        error = r.error();
+        return false;
+    }
+
+    SharedArray<uint32_t> entryStrings;
+    SharedArray<int> students;
+    IndexLists groupIdStrings;
+    r.shared(EntryStrings, n * 4, owner, entryStrings);
+    r.shared(EntryStudents, n, owner, students);
+    r.csr(EntryGroupIdOffsets, EntryGroupIdStrings, n, std::numeric_limits<int>::max(), owner, groupIdStrings);
+    loaded.entries_.assign(r.ok() ? n : 0, UnscheduledEntry());
+    for (size_t i = 0; i < loaded.entries_.size(); ++i) {
+        UnscheduledEntry& e = loaded.entries_[i];
+        e.uid = r.str(entryStrings[4 * i]);
+        e.subjectId = r.str(entryStrings[4 * i + 1]);
+        e.teacherId = r.str(entryStrings[4 * i + 2]);
+        e.classType = r.str(entryStrings[4 * i + 3]);
+        e.studentCount = students[i];
+        for (int s : groupIdStrings[i]) e.groupIds.push_back(r.str(s));
+    }
+
+    r.shared(TeacherAvail, numTeachers * numDays * numSlots, owner, loaded.fastTeacherAvail_);
+    r.shared(GroupAvail, numGroups * numDays * numSlots, owner, loaded.fastGroupAvail_);
+
+    r.indices(TeacherPins, numTeachers, -1, numRooms, loaded.fastTeacherPin_);
+    r.indices(GroupPins, numGroups, -1, numRooms, loaded.fastGroupPin_);
+    r.indices(SubjectPins, numSubjects, -1, numRooms, loaded.fastSubjectPin_);
+    size_t numSignatures = std::max<size_t>(r.count(SignatureOffsets), 1) - 1;
+    r.csr(SignatureOffsets, SignatureRooms, numSignatures, numRooms, owner, loaded.signatureRooms_);
+    r.indices(EntrySignatures, n, 0, numSignatures, loaded.entrySignature_);
+    r.indices(EntryTeachers, n, -1, numTeachers, loaded.entryTeacher_);
+    r.indices(EntrySubjects, n, -1, numSubjects, loaded.entrySubject_);
+    r.csr(EntryGroupOffsets, EntryGroups, n, numGroups, owner, loaded.entryGroups_);
+    r.csr(TeacherEntryOffsets, TeacherEntries, numTeachers, n, owner, loaded.teacherEntries_);
+    r.csr(GroupEntryOffsets, GroupEntries, numGroups, n, owner, loaded.groupEntries_);
+
+    std::vector<int32_t> scalars;
+    r.array(Scalars, 2, scalars);
+    loaded.numRoomTypes_ = r.ok() ? scalars[0] : 0;
+    r.indices(ClassroomTypes, numRooms, 0, std::max(loaded.numRoomTypes_, 1), loaded.classroomType_);
+
+    DistributionTracker::Model& dm = loaded.distributionModel_;
+    dm.numDays = numDays;
+    dm.numSlots = numSlots;
+    dm.numGroups = numGroups;
+    dm.id = DistributionTracker::newModelId();
+    dm.saturday = r.ok() ? scalars[1] : -1;
+    dm.entryGroups = loaded.entryGroups_;
+    dm.entrySubject = loaded.entrySubject_;
+    r.indices(EntryKinds, n, DistributionTracker::Other, DistributionTracker::Practice + 1, dm.entryKind);
+    if (dm.saturday >= (int)numDays || dm.saturday < -1) r.fail("saturday index out of range");
+
+    std::vector<uint64_t> rulesHash;
+    std::vector<int32_t> actions, cells, params;
+    std::vector<double> penalties;
+    SharedArray<uint8_t> applies;
+    IndexLists keys;
+    r.array(RulesHash, 1, rulesHash);
+    size_t numRules = r.count(RuleActions);
+    r.array(RuleActions, numRules, actions);
+    r.array(RuleCells, numRules, cells);
+    r.array(RuleParams, numRules, params);
+    r.array(RulePenalties, numRules, penalties);
+    r.shared(RuleApplies, numRules * n, owner, applies);
+    r.csr(RuleKeyOffsets, RuleKeys, numRules * n, std::max(numTeachers, numGroups), owner, keys);
+    for (size_t k = 0; k < numRules && r.ok(); ++k) {
+        if (actions[k] < (int)RuleAction::AvoidTime || actions[k] > (int)RuleAction::MaxPerDay) r.fail("unknown rule action");
+        else if (cells[k] < -1 || cells[k] >= (int)(numDays * numSlots)) r.fail("rule cell out of range");
+    }
+    loaded.snapshotRules_.assign(r.ok() ? numRules : 0, CompiledRule());
+    for (size_t k = 0; k < loaded.snapshotRules_.size(); ++k) {
+        CompiledRule& rule = loaded.snapshotRules_[k];
+        rule.action = (RuleAction)actions[k];
+        rule.cell = cells[k];
+        rule.param = params[k];
+        rule.penalty = penalties[k];
+        rule.applies.assign(applies.begin() + k * n, applies.begin() + (k + 1) * n);
+        if (rule.action == RuleAction::MaxPerDay) {
+            // Rule k's lists are offsets [k * n, (k + 1) * n] of the shared CSR
+            rule.keys = IndexLists(SharedArray<uint32_t>(owner, keys.offsets().begin() + k * n, n + 1), keys.values());
+        }
+    }
+    loaded.snapshotRulesHash_ = r.ok() ? rulesHash[0] : 0;
+    loaded.hasSnapshotRules_ = r.ok();
+
+    if (!r.ok()) {
+        error = r.error();
+        return false;
+    }
+
+    // Id lookups used on the way back to ScheduleEntry; cheap compared to indexify()
+    loaded.config_ = config;
+    loaded.teacherMap_.clear(); loaded.groupMap_.clear(); loaded.classroomMap_.clear(); loaded.subjectMap_.clear();
+    loaded.tIdx_.clear(); loaded.gIdx_.clear(); loaded.cIdx_.clear(); loaded.sIdx_.clear(); loaded.tsIdx_.clear(); loaded.dIdx_.clear();
+    for (size_t i = 0; i < loaded.teachers_.size(); ++i) { loaded.teacherMap_[loaded.teachers_[i].id] = &loaded.teachers_[i]; loaded.tIdx_[loaded.teachers_[i].id] = i; }
+    for (size_t i = 0; i < loaded.groups_.size(); ++i) { loaded.groupMap_[loaded.groups_[i].id] = &loaded.groups_[i]; loaded.gIdx_[loaded.groups_[i].id] = i; }
+    for (size_t i = 0; i < loaded.classrooms_.size(); ++i) { loaded.classroomMap_[loaded.classrooms_[i].id] = &loaded.classrooms_[i]; loaded.cIdx_[loaded.classrooms_[i].id] = i; }
+    for (size_t i = 0; i < loaded.subjects_.size(); ++i) { loaded.subjectMap_[loaded.subjects_[i].id] = &loaded.subjects_[i]; loaded.sIdx_[loaded.subjects_[i].id] = i; }
+    for (size_t i = 0; i < loaded.timeSlots_.size(); ++i) loaded.tsIdx_[loaded.timeSlots_[i].id] = i;
+    for (size_t i = 0; i < loaded.workDays_.size(); ++i) loaded.dIdx_[loaded.workDays_[i]] = i;
+    loaded.entryIdx_.clear();
+    for (size_t i = 0; i < loaded.entries_.size(); ++i) loaded.entryIdx_[loaded.entries_[i].uid] = i;
+    // Moving keeps the vector buffers, so the id -> entity pointers stay valid
+    *this = std::move(loaded);
+    return true;
+}
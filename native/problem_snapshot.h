@@ -0,0 +1,59 @@
+#ifndef PROBLEM_SNAPSHOT_H
+#define PROBLEM_SNAPSHOT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Precompiled problem snapshots: the fully indexed state of a Scheduler (interned ids,
+// flat availability, pins, suitable rooms, distribution model) and the scheduling rules of
+// one config compiled, saved by Scheduler::saveSnapshot. Scheduler::loadSnapshot maps the
+// file and skips parsing the source data and the room and conflict searches of indexify().
+// The availability tables and the index lists (suitable rooms, entry groups, teacher and
+// group entries, MaxPerDay keys) are used in place from the mapping, which stays open as
+// long as the Scheduler uses them. Still decoded on load: ids, entries and their lookup
+// maps, the per-entry and per-entity int arrays and the rules' applies flags.
+// The compiled rules are used by a solve whose config has the same hashRules().
+//
+// The file is relocatable: it holds no pointers, only offsets from its start.
+//   header  = "SSNP", u32 version, u64 sourceHash, u32 sectionCount, u32 reserved
+//   section table = sectionCount x (u32 id, u32 elementSize, u64 offset, u64 count)
+//   section data, each 8-byte aligned
+// Integers are stored in host order; snapshots are a local cache, not an exchange format.
+//
+// sourceHash is hashProblemBuffer() of the source problem buffer (problem_buffer.h).
+// A snapshot whose hash does not match the caller's source data is rejected as stale.
+
+const uint32_t kSnapshotVersion = 3;
+
+struct Config;
+
+// FNV-1a 64 over the source problem bytes
+uint64_t hashProblemBuffer(const uint8_t* data, size_t size);
+// FNV-1a 64 over what compiled scheduling rules depend on: the rules and the strictness
+uint64_t hashRules(const Config& config);
+
+// Read-only memory mapping of a whole file (mmap / MapViewOfFile)
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
+
+#endif // PROBLEM_SNAPSHOT_H
@@ -1,4 +1,5 @@
 #include "scheduler.h"
+#include "problem_snapshot.h"
 #include <algorithm>
 #include <iostream>
 #include <limits>
@@ -6,6 +7,30 @@
 #include <chrono>
 #include <cmath>
 #include <unordered_set>
+#include <tuple>
+#include <memory>
+
+namespace {
+
+// Cost terms shared by calculateCost and the incremental LNS scoring
+
+// Double bookings: every class beyond the first in one teacher, group or room cell
+double overbookingCost(int count) {
+    return count > 1 ? (count - 1) * 10000.0 : 0.0;
+}
+
+// Standard rules: a teacher's or a group's classes on one day beyond the comfortable load
+double teacherDayLoadCost(int load, double penaltyMultiplier) {
+    return load >= 4 ? (load - 3) * 150 * penaltyMultiplier : 0.0;
+}
+
+double groupDayLoadCost(int load, double penaltyMultiplier) {
+    if (load >= 5) return (load - 4) * 200 * penaltyMultiplier;
+    if (load >= 4) return (load - 3) * 100 * penaltyMultiplier;
+    return 0.0;
+}
+
+} // namespace
 
 Scheduler::Scheduler() {}
 
@@ -36,6 +61,11 @@ void Scheduler::loadData(
     indexify();
 }
 
+void Scheduler::loadData(const Problem& problem, const Config& config) {
+    loadData(problem.teachers, problem.groups, problem.classrooms, problem.subjects,
+             problem.timeSlots, problem.entries, config);
+}
+
 void Scheduler::indexify() {
     // 1. Create Mappings
     for (size_t i = 0; i < teachers_.size(); ++i) tIdx_[teachers_[i].id] = i;
@@ -49,7 +79,7 @@ void Scheduler::indexify() {
     int numDays = workDays_.size();
     int numSlots = timeSlots_.size();
 
-    fastTeacherAvail_.assign(teachers_.size(), std::vector<std::vector<int>>(numDays, std::vector<int>(numSlots, 0)));
+    std::vector<int8_t> teacherAvail(teachers_.size() * numDays * numSlots, 0);
     for (size_t i = 0; i < teachers_.size(); ++i) {
         for (size_t d = 0; d < numDays; ++d) {
             for (size_t s = 0; s < numSlots; ++s) {
@@ -57,14 +87,15 @@ void Scheduler::indexify() {
                 if (itDay != teachers_[i].availabilityGrid.grid.end()) {
                     auto itSlot = itDay->second.find(timeSlots_[s].id);
                     if (itSlot != itDay->second.end()) {
-                        fastTeacherAvail_[i][d][s] = (int)itSlot->second;
+                        teacherAvail[(i * numDays + d) * numSlots + s] = (int8_t)itSlot->second;
                     }
                 }
             }
         }
     }
+    fastTeacherAvail_ = SharedArray<int8_t>(std::move(teacherAvail));
 
-    fastGroupAvail_.assign(groups_.size(), std::vector<std::vector<int>>(numDays, std::vector<int>(numSlots, 0)));
+    std::vector<int8_t> groupAvail(groups_.size() * numDays * numSlots, 0);
     for (size_t i = 0; i < groups_.size(); ++i) {
         for (size_t d = 0; d < numDays; ++d) {
             for (size_t s = 0; s < numSlots; ++s) {
@@ -72,12 +103,13 @@ void Scheduler::indexify() {
                 if (itDay != groups_[i].availabilityGrid.grid.end()) {
                     auto itSlot = itDay->second.find(timeSlots_[s].id);
                     if (itSlot != itDay->second.end()) {
-                        fastGroupAvail_[i][d][s] = (int)itSlot->second;
+                        groupAvail[(i * numDays + d) * numSlots + s] = (int8_t)itSlot->second;
                     }
                 }
             }
         }
     }
+    fastGroupAvail_ = SharedArray<int8_t>(std::move(groupAvail));
 
     // 3. Pre-calc Pins
     fastTeacherPin_.assign(teachers_.size(), -1);
@@ -98,41 +130,705 @@ void Scheduler::indexify() {
             fastSubjectPin_[i] = cIdx_[subjects_[i].pinnedClassroomId];
     }
 
-    // 4. Pre-calc Suitable Rooms for Entries
-    entrySuitableRooms_.resize(entries_.size());
+    // 4. Pre-calc Suitable Rooms, shared by entries with the same (subject, classType, studentCount).
+    // Rooms are ranked by capacity (largest first), so the rooms that fit a group are a prefix of
+    // the ranking and suitability is prefix & type bits & tag bits over 64-bit words.
+    size_t numRooms = classrooms_.size();
+    size_t words = (numRooms + 63) / 64;
+    std::vector<int> byCapacity(numRooms);
+    for (size_t c = 0; c < numRooms; ++c) byCapacity[c] = c;
+    std::stable_sort(byCapacity.begin(), byCapacity.end(),
+                     [&](int a, int b) { return classrooms_[a].capacity > classrooms_[b].capacity; });
+
+    std::unordered_map<std::string, std::vector<uint64_t>> typeBits, tagBits;
+    auto setBit = [&](std::unordered_map<std::string, std::vector<uint64_t>>& bits, const std::string& key, size_t rank) {
+        auto& row = bits[key];
+        if (row.empty()) row.assign(words, 0);
+        row[rank / 64] |= 1ULL << (rank % 64);
+    };
+    for (size_t rank = 0; rank < numRooms; ++rank) {
+        const auto& room = classrooms_[byCapacity[rank]];
+        setBit(typeBits, room.typeId, rank);
+        for (const auto& tag : room.tagIds) setBit(tagBits, tag, rank);
+    }
+
+    entrySignature_.assign(entries_.size(), 0);
+    std::vector<std::vector<int>> signatureRooms(1); // 0: entries of unknown subjects
+    std::map<std::tuple<int, std::string, int>, int> signatureIdx;
+    std::vector<uint64_t> mask(words), anyType(words);
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        const auto& entry = entries_[i];
+        auto itS = sIdx_.find(entry.subjectId);
+        if (itS == sIdx_.end()) continue;
+        auto key = std::make_tuple(itS->second, entry.classType, entry.studentCount);
+        auto itSig = signatureIdx.find(key);
+        if (itSig != signatureIdx.end()) {
+            entrySignature_[i] = itSig->second;
+            continue;
+        }
+        const Subject& subject = subjects_[itS->second];
+
+        size_t fit = std::partition_point(byCapacity.begin(), byCapacity.end(),
+            [&](int c) { return classrooms_[c].capacity >= entry.studentCount; }) - byCapacity.begin();
+        std::fill(mask.begin(), mask.end(), 0);
+        for (size_t w = 0; w < fit / 64; ++w) mask[w] = ~0ULL;
+        if (fit % 64) mask[fit / 64] = (1ULL << (fit % 64)) - 1;
+
+        auto itReq = subject.classroomTypeRequirements.find(entry.classType);
+        if (itReq != subject.classroomTypeRequirements.end()) {
+            std::fill(anyType.begin(), anyType.end(), 0);
+            for (const auto& type : itReq->second) {
+                auto itType = typeBits.find(type);
+                if (itType == typeBits.end()) continue;
+                for (size_t w = 0; w < words; ++w) anyType[w] |= itType->second[w];
+            }
+            for (size_t w = 0; w < words; ++w) mask[w] &= anyType[w];
+        }
+        for (const auto& tag : subject.requiredClassroomTagIds) {
+            auto itTag = tagBits.find(tag);
+            if (itTag == tagBits.end()) {
+                std::fill(mask.begin(), mask.end(), 0);
+                break;
+            }
+            for (size_t w = 0; w < words; ++w) mask[w] &= itTag->second[w];
+        }
+
+        std::vector<int> rooms;
+        for (size_t w = 0; w < words; ++w) {
+            for (uint64_t bits = mask[w]; bits; bits &= bits - 1) {
+                int bit = 0;
+                while (!((bits >> bit) & 1)) ++bit;
+                rooms.push_back(byCapacity[w * 64 + bit]);
+            }
+        }
+        // Classroom order, as before: placement tie-breaks depend on it
+        std::sort(rooms.begin(), rooms.end());
+        entrySignature_[i] = signatureRooms.size();
+        signatureIdx.emplace(key, (int)signatureRooms.size());
+        signatureRooms.push_back(std::move(rooms));
+    }
+    signatureRooms_ = IndexLists(signatureRooms);
+
+    // 5. Intern Entry References
+    entryIdx_.clear();
+    entryTeacher_.assign(entries_.size(), -1);
+    entrySubject_.assign(entries_.size(), -1);
+    std::vector<std::vector<int>> entryGroups(entries_.size());
+    std::vector<std::vector<int>> teacherEntries(teachers_.size());
+    std::vector<std::vector<int>> groupEntries(groups_.size());
     for (size_t i = 0; i < entries_.size(); ++i) {
         const auto& entry = entries_[i];
-        Subject* subject = subjectMap_[entry.subjectId];
-        if (!subject) continue;
-
-        for (size_t c = 0; c < classrooms_.size(); ++c) {
-            const auto& room = classrooms_[c];
-            if (room.capacity < entry.studentCount) continue;
-
-            bool typeMatch = false;
-            if (subject->classroomTypeRequirements.count(entry.classType)) {
-                const auto& reqs = subject->classroomTypeRequirements.at(entry.classType);
-                for (const auto& r : reqs) if (r == room.typeId) { typeMatch = true; break; }
-            } else { typeMatch = true; }
-
-            if (typeMatch && !subject->requiredClassroomTagIds.empty()) {
-                for (const auto& reqTag : subject->requiredClassroomTagIds) {
-                    bool hasTag = false;
-                    for (const auto& cTag : room.tagIds) if (cTag == reqTag) hasTag = true;
-                    if (!hasTag) { typeMatch = false; break; }
+        entryIdx_[entry.uid] = i;
+        auto itT = tIdx_.find(entry.teacherId);
+        if (itT != tIdx_.end()) {
+            entryTeacher_[i] = itT->second;
+            teacherEntries[itT->second].push_back(i);
+        }
+        auto itS = sIdx_.find(entry.subjectId);
+        if (itS != sIdx_.end()) entrySubject_[i] = itS->second;
+        for (const auto& gid : entry.groupIds) {
+            auto itG = gIdx_.find(gid);
+            if (itG == gIdx_.end()) continue;
+            entryGroups[i].push_back(itG->second);
+            groupEntries[itG->second].push_back(i);
+        }
+    }
+    entryGroups_ = IndexLists(entryGroups);
+    teacherEntries_ = IndexLists(teacherEntries);
+    groupEntries_ = IndexLists(groupEntries);
+
+    std::map<std::string, int> typeIdx;
+    classroomType_.assign(classrooms_.size(), 0);
+    for (size_t c = 0; c < classrooms_.size(); ++c) {
+        auto it = typeIdx.find(classrooms_[c].typeId);
+        if (it == typeIdx.end()) it = typeIdx.emplace(classrooms_[c].typeId, (int)typeIdx.size()).first;
+        classroomType_[c] = it->second;
+    }
+    numRoomTypes_ = typeIdx.size();
+
+    // 6. Distribution Model: groups, subjects and kinds of the classes
+    DistributionTracker::Model& dm = distributionModel_;
+    dm.id = DistributionTracker::newModelId();
+    dm.numDays = numDays;
+    dm.numSlots = numSlots;
+    dm.numGroups = groups_.size();
+    dm.saturday = dIdx_.count("Суббота") ? dIdx_["Суббота"] : -1;
+    dm.entryGroups = entryGroups_;
+    dm.entryKind.assign(entries_.size(), DistributionTracker::Other);
+    dm.entrySubject = entrySubject_;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        const std::string& classType = entries_[i].classType;
+        if (classType == "Лекция") dm.entryKind[i] = DistributionTracker::Lecture;
+        else if (classType == "Практика" || classType == "Лабораторная") dm.entryKind[i] = DistributionTracker::Practice;
+    }
+}
+
+bool validateConfig(const Config& config, std::string& error) {
+    // NaN fails every comparison, so each range check also rejects it
+    const LnsSettings& lns = config.lns;
+    const char* invalid = nullptr;
+    if (!(config.timeLimitSeconds >= 0 && std::isfinite(config.timeLimitSeconds))) {
+        invalid = "timeLimitSeconds must be a finite number >= 0";
+    } else if (lns.iterations < 0) {
+        invalid = "lns.iterations must be >= 0";
+    } else if (lns.parallelRepairs < 1 || lns.parallelRepairs > 1024) {
+        invalid = "lns.parallelRepairs must be in [1, 1024]";
+    } else if (!(lns.destroyFraction > 0 && lns.destroyFraction <= 1)) {
+        invalid = "lns.destroyFraction must be in (0, 1]";
+    } else if (!(lns.recordDeviation >= 0 && std::isfinite(lns.recordDeviation))) {
+        invalid = "lns.recordDeviation must be a finite number >= 0";
+    } else if (!(config.decomposition.maxRoomOverlap >= 0 && config.decomposition.maxRoomOverlap <= 1)) {
+        invalid = "decomposition.maxRoomOverlap must be in [0, 1]";
+    }
+    if (invalid) {
+        error = invalid;
+        return false;
+    }
+
+    for (const auto& rule : config.schedulingRules) {
+        int action = (int)rule.action;
+        int severity = (int)rule.severity;
+        if (action < (int)RuleAction::AvoidTime || action > (int)RuleAction::MaxPerDay) {
+            error = "rule '" + rule.id + "': action " + std::to_string(action) + " is not supported by the native scheduler";
+            return false;
+        }
+        if (severity < (int)RuleSeverity::Strict || severity > (int)RuleSeverity::Weak) {
+            error = "rule '" + rule.id + "': bad severity " + std::to_string(severity);
+            return false;
+        }
+        if (rule.action == RuleAction::MaxPerDay && rule.param < 0) {
+            error = "rule '" + rule.id + "': MaxPerDay needs a non-negative param";
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<Scheduler::CompiledRule> Scheduler::compileRules(const Config& config) const {
+    double penaltyMultiplier = config.strictness / 5.0;
+    int numSlots = timeSlots_.size();
+    std::vector<CompiledRule> rules;
+    for (const auto& rule : config.schedulingRules) {
+        if (rule.conditions.empty()) continue;
+        const RuleCondition& condition = rule.conditions[0];
+        const std::string& type = condition.entityType;
+
+        CompiledRule compiled;
+        std::vector<std::vector<int>> keys; // MaxPerDay, packed into compiled.keys
+        compiled.action = rule.action;
+        switch (rule.severity) {
+            case RuleSeverity::Strict: compiled.penalty = 1000000; break;
+            case RuleSeverity::Strong: compiled.penalty = 500 * penaltyMultiplier; break;
+            case RuleSeverity::Medium: compiled.penalty = 100 * penaltyMultiplier; break;
+            case RuleSeverity::Weak: compiled.penalty = 20 * penaltyMultiplier; break;
+        }
+        if (rule.action == RuleAction::AvoidTime || rule.action == RuleAction::PreferTime) {
+            auto itD = dIdx_.find(rule.day);
+            auto itS = tsIdx_.find(rule.timeSlotId);
+            if (itD == dIdx_.end() || itS == tsIdx_.end()) continue; // names no cell of the week
+            compiled.cell = itD->second * numSlots + itS->second;
+        } else if (rule.action == RuleAction::MaxPerDay) {
+            if (type != "teacher" && type != "group" && type != "subject") continue; // counts nothing
+            compiled.param = rule.param;
+            keys.assign(entries_.size(), std::vector<int>());
+        } else {
+            continue;
+        }
+
+        std::unordered_set<std::string> ids(condition.entityIds.begin(), condition.entityIds.end());
+        compiled.applies.assign(entries_.size(), 0);
+        bool any = false;
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            const auto& entry = entries_[i];
+            bool applies = false;
+            if (type == "teacher") {
+                applies = ids.count(entry.teacherId) > 0;
+            } else if (type == "group") {
+                for (const auto& gid : entry.groupIds) applies = applies || ids.count(gid) > 0;
+            } else if (type == "subject") {
+                applies = ids.count(entry.subjectId) && (condition.classType.empty() || condition.classType == entry.classType);
+            } else if (type == "classType") {
+                applies = ids.count(entry.classType) > 0;
+            }
+            if (!applies) continue;
+            compiled.applies[i] = 1;
+            any = true;
+
+            // MaxPerDay counts the teacher's classes, the named groups' classes, or the
+            // subject's classes per group of the entry
+            if (rule.action != RuleAction::MaxPerDay) continue;
+            if (type == "teacher") {
+                if (entryTeacher_[i] != -1) keys[i].push_back(entryTeacher_[i]);
+            } else if (type == "group") {
+                for (int g : entryGroups_[i]) {
+                    if (ids.count(groups_[g].id)) keys[i].push_back(g);
                 }
+            } else {
+                keys[i].assign(entryGroups_[i].begin(), entryGroups_[i].end());
             }
+        }
+        if (!any) continue;
+        if (!keys.empty()) compiled.keys = IndexLists(keys);
+        rules.push_back(std::move(compiled));
+    }
+    return rules;
+}
+
+const std::vector<Scheduler::CompiledRule>& Scheduler::rulesFor(const Config& config,
+                                                                 std::vector<CompiledRule>& scratch) const {
+    if (hasSnapshotRules_ && snapshotRulesHash_ == hashRules(config)) return snapshotRules_;
+    scratch = compileRules(config);
+    return scratch;
+}
+
+IndexLists::IndexLists(const std::vector<std::vector<int>>& lists) {
+    std::vector<uint32_t> offsets(1, 0);
+    std::vector<int> values;
+    for (const auto& list : lists) {
+        values.insert(values.end(), list.begin(), list.end());
+        offsets.push_back(values.size());
+    }
+    offsets_ = SharedArray<uint32_t>(std::move(offsets));
+    values_ = SharedArray<int>(std::move(values));
+}
+
+DistributionTracker::DistributionTracker(const Model& model, const Config& config)
+    : model_(&model), modelId_(model.id) {
+    setWeights(config);
+    groupDayHead_.assign(model.numGroups * model.numDays, -1);
+    nodes_.reserve(model.entryGroups.values().size());
+    repeatHits_.assign(model.entryKind.size(), 0);
+    ownPracticeHits_.assign(model.entryKind.size(), 0);
+    otherPracticeHits_.assign(model.entryKind.size(), 0);
+    groupDayLoad_.assign(model.numGroups * model.numDays, 0);
+    groupWeekLoad_.assign(model.numGroups, 0);
+}
+
+void DistributionTracker::setWeights(const Config& config) {
+    double penaltyMultiplier = config.strictness / 5.0;
+    bool standard = config.settings.enforceStandardRules;
+    sameSubjectWeight_ = standard ? 75 * penaltyMultiplier : 0;
+    // "Avoid Saturday" of the standard rules plus the unconditional weekday preference
+    saturdayWeight_ = ((standard ? 60 : 0) + 25) * penaltyMultiplier;
+    lectureAfterPracticeWeight_ = standard ? 350 * penaltyMultiplier : 0;
+    orderWeight_ = config.enforceLectureOrder ? 300 * penaltyMultiplier : 0;
+    unevenWeight_ = config.distributeEvenly ? 10 * penaltyMultiplier : 0;
+}
+
+bool DistributionTracker::enabled(const Model& model, const Config& config) {
+    return model.saturday >= 0 || config.settings.enforceStandardRules || config.enforceLectureOrder
+        || config.distributeEvenly;
+}
 
-            if (typeMatch) {
-                entrySuitableRooms_[i].push_back(c);
+uint64_t DistributionTracker::newModelId() {
+    static std::atomic<uint64_t> next{1};
+    return next++;
+}
+
+void DistributionTracker::add(int entryIdx, const Placement& p) {
+    update(entryIdx, p, 1);
+}
+
+void DistributionTracker::remove(int entryIdx, const Placement& p) {
+    update(entryIdx, p, -1);
+}
+
+void DistributionTracker::setFinding(int entryIdx, bool& flag, bool value, std::vector<int>& hits, long long& total) {
+    if (flag == value) return;
+    flag = value;
+    int& count = hits[entryIdx];
+    if (value && count++ == 0) total++;
+    if (!value && --count == 0) total--;
+}
+
+void DistributionTracker::recountDay(int head) {
+    // A handful of classes per group and day, so pairwise is cheap
+    for (int c = head; c != -1; c = nodes_[c].next) {
+        DayClass& cls = nodes_[c];
+        bool repeat = false;
+        bool own = false;
+        bool other = false;
+        for (int k = head; k != -1; k = nodes_[k].next) {
+            const DayClass& earlier = nodes_[k];
+            if (earlier.slot > cls.slot || (earlier.slot == cls.slot && earlier.entry >= cls.entry)) continue;
+            if (earlier.subject == cls.subject) repeat = true;
+            if (cls.kind != Lecture || earlier.kind != Practice || earlier.slot == cls.slot) continue;
+            if (earlier.subject == cls.subject) own = true;
+            else other = true;
+        }
+        setFinding(cls.entry, cls.repeat, repeat, repeatHits_, repeatedSubjects_);
+        if (cls.kind != Lecture) continue;
+        setFinding(cls.entry, cls.afterOwnPractice, own, ownPracticeHits_, orderViolations_);
+        setFinding(cls.entry, cls.afterOtherPractice, other, otherPracticeHits_, lecturesAfterPractice_);
+    }
+}
+
+void DistributionTracker::update(int entryIdx, const Placement& p, int delta) {
+    if (p.day < 0) return;
+    const Model& m = *model_;
+    int kind = m.entryKind[entryIdx];
+
+    if (p.day == m.saturday) saturdayClasses_ += delta;
+
+    for (int g : m.entryGroups[entryIdx]) {
+        // (x + 1)^2 - x^2 = 2x + 1, (x - 1)^2 - x^2 = -2x + 1
+        int& dayLoad = groupDayLoad_[g * m.numDays + p.day];
+        int& weekLoad = groupWeekLoad_[g];
+        sumSquaredDayLoad_ += 2LL * delta * dayLoad + 1;
+        sumSquaredWeekLoad_ += 2LL * delta * weekLoad + 1;
+        dayLoad += delta;
+        weekLoad += delta;
+
+        int& head = groupDayHead_[g * m.numDays + p.day];
+        if (delta > 0) {
+            int node = freeNode_;
+            if (node != -1) {
+                freeNode_ = nodes_[node].next;
+            } else {
+                node = nodes_.size();
+                nodes_.emplace_back();
+            }
+            nodes_[node] = DayClass{ entryIdx, p.slot, m.entrySubject[entryIdx], kind, false, false, false, head };
+            head = node;
+        } else {
+            for (int* link = &head; *link != -1; link = &nodes_[*link].next) {
+                DayClass& node = nodes_[*link];
+                if (node.entry != entryIdx || node.slot != p.slot) continue;
+                setFinding(entryIdx, node.repeat, false, repeatHits_, repeatedSubjects_);
+                setFinding(entryIdx, node.afterOwnPractice, false, ownPracticeHits_, orderViolations_);
+                setFinding(entryIdx, node.afterOtherPractice, false, otherPracticeHits_, lecturesAfterPractice_);
+                int removed = *link;
+                *link = node.next;
+                nodes_[removed].next = freeNode_;
+                freeNode_ = removed;
+                break;
             }
         }
+        recountDay(head);
     }
 }
 
+double DistributionTracker::penalty() const {
+    // Sum over groups of (sum of squared day loads - squared week load / days) is
+    // days * variance of the daily load, zero for a perfectly even week
+    double uneven = model_->numDays ? sumSquaredDayLoad_ - (double)sumSquaredWeekLoad_ / model_->numDays : 0;
+    return sameSubjectWeight_ * repeatedSubjects_
+         + orderWeight_ * orderViolations_
+         + unevenWeight_ * uneven
+         + saturdayWeight_ * saturdayClasses_
+         + lectureAfterPracticeWeight_ * lecturesAfterPractice_;
+}
+
+SnapshotStream::SnapshotStream(double intervalSeconds, size_t capacity)
+    : queue_(std::max<size_t>(capacity, 2)), intervalNs_((long long)(std::max(0.0, intervalSeconds) * 1e9)) {}
+
+void SnapshotStream::setNotify(std::function<void()> notify) {
+    notify_ = std::move(notify);
+}
+
+bool SnapshotStream::pop(SnapshotDiff& out) {
+    if (queue_.pop(out)) return true;
+    // Nothing is queued after a parked final diff, so it comes last
+    if (!finalParked_.load(std::memory_order_acquire)) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!finalParked_.load(std::memory_order_relaxed)) return false;
+    out = std::move(parkedFinal_);
+    finalParked_.store(false, std::memory_order_relaxed);
+    return true;
+}
+
+void SnapshotStream::begin(int numEntries, int numParts) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    current_.assign(numEntries, Placement());
+    published_.assign(numEntries, Placement());
+    partCost_.assign(numParts, std::numeric_limits<double>::infinity());
+    finalParked_.store(false, std::memory_order_relaxed);
+    nextDue_.store(0, std::memory_order_relaxed);
+}
+
+void SnapshotStream::offer(int part, const std::vector<int>& entries, const std::vector<Placement>& placements, double cost) {
+    // Cheap early-out for the common case: improvements between two snapshots are skipped
+    long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (now < nextDue_.load(std::memory_order_relaxed)) return;
+
+    bool published;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (part < 0 || part >= (int)partCost_.size() || cost >= partCost_[part]) return;
+        partCost_[part] = cost;
+        for (int e : entries) current_[e] = placements[e];
+        if (now < nextDue_.load(std::memory_order_relaxed)) return;
+        nextDue_.store(now + intervalNs_, std::memory_order_relaxed);
+
+        double total = 0;
+        for (double c : partCost_) {
+            if (c != std::numeric_limits<double>::infinity()) total += c;
+        }
+        published = publish(total, false);
+    }
+    if (published && notify_) notify_();
+}
+
+void SnapshotStream::finish(const std::vector<Placement>& placements, double cost) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        current_ = placements;
+        nextDue_.store(std::numeric_limits<long long>::max(), std::memory_order_relaxed);
+        publish(cost, true);
+    }
+    if (notify_) notify_();
+}
+
+bool SnapshotStream::publish(double cost, bool final) {
+    SnapshotDiff diff;
+    for (size_t i = 0; i < current_.size(); ++i) {
+        const Placement& a = current_[i];
+        const Placement& b = published_[i];
+        if (a.day == b.day && a.slot == b.slot && a.room == b.room) continue;
+        diff.entries.push_back(i);
+        diff.placements.push_back(a);
+    }
+    if (diff.entries.empty() && !final) return false;
+    diff.version = version_ + 1;
+    diff.cost = cost;
+    diff.final = final;
+
+    if (!queue_.push(diff)) {
+        if (!final) return false;
+        // The final diff must not be lost, but a stalled consumer must not block the solver
+        parkedFinal_ = std::move(diff);
+        finalParked_.store(true, std::memory_order_release);
+    }
+    version_++;
+    published_ = current_;
+    return true;
+}
+
+int Scheduler::OccupancyView::teacherAt(int cell) const {
+    auto it = teacher.find(cell);
+    return base->teacher[cell] + (it != teacher.end() ? it->second : 0);
+}
+
+int Scheduler::OccupancyView::groupAt(int cell) const {
+    auto it = group.find(cell);
+    return base->group[cell] + (it != group.end() ? it->second : 0);
+}
+
+int Scheduler::OccupancyView::roomAt(int cell) const {
+    auto it = room.find(cell);
+    return base->room[cell] + (it != room.end() ? it->second : 0);
+}
+
+std::vector<Placement> Scheduler::toPlacements(const std::vector<ScheduleEntry>& schedule) const {
+    std::vector<Placement> placements(entries_.size());
+    for (const auto& entry : schedule) {
+        auto itE = entryIdx_.find(entry.unscheduledUid);
+        auto itD = dIdx_.find(entry.day);
+        auto itS = tsIdx_.find(entry.timeSlotId);
+        if (itE == entryIdx_.end() || itD == dIdx_.end() || itS == tsIdx_.end()) continue;
+        auto itC = cIdx_.find(entry.classroomId);
+
+        Placement& p = placements[itE->second];
+        p.day = itD->second;
+        p.slot = itS->second;
+        p.room = itC != cIdx_.end() ? itC->second : -1;
+    }
+    return placements;
+}
+
+std::vector<ScheduleEntry> Scheduler::toSchedule(const std::vector<Placement>& placements) const {
+    std::vector<ScheduleEntry> schedule;
+    for (size_t i = 0; i < placements.size(); ++i) {
+        const Placement& p = placements[i];
+        if (p.day < 0) continue;
+        const auto& entry = entries_[i];
+        ScheduleEntry se;
+        se.id = "sched-" + entry.uid;
+        se.day = workDays_[p.day];
+        se.timeSlotId = timeSlots_[p.slot].id;
+        se.classroomId = p.room >= 0 ? classrooms_[p.room].id : "";
+        se.subjectId = entry.subjectId;
+        se.teacherId = entry.teacherId;
+        se.groupIds = entry.groupIds;
+        se.classType = entry.classType;
+        se.unscheduledUid = entry.uid;
+        schedule.push_back(se);
+    }
+    return schedule;
+}
+
+void Scheduler::applyToOccupancy(Occupancy& occupancy, int entryIdx, const Placement& p, int delta) const {
+    if (p.day < 0) return;
+    int cells = workDays_.size() * timeSlots_.size();
+    int offset = p.day * timeSlots_.size() + p.slot;
+    int t = entryTeacher_[entryIdx];
+    if (t != -1) occupancy.teacher[t * cells + offset] += delta;
+    for (int g : entryGroups_[entryIdx]) occupancy.group[g * cells + offset] += delta;
+    if (p.room != -1) occupancy.room[p.room * cells + offset] += delta;
+}
+
+void Scheduler::applyToView(OccupancyView& view, int entryIdx, const Placement& p, int delta) const {
+    if (p.day < 0) return;
+    int cells = workDays_.size() * timeSlots_.size();
+    int offset = p.day * timeSlots_.size() + p.slot;
+    int t = entryTeacher_[entryIdx];
+    if (t != -1) view.teacher[t * cells + offset] += delta;
+    for (int g : entryGroups_[entryIdx]) view.group[g * cells + offset] += delta;
+    if (p.room != -1) view.room[p.room * cells + offset] += delta;
+}
+
+Scheduler::Occupancy Scheduler::buildOccupancy(const std::vector<Placement>& placements, const SolveContext& ctx) const {
+    int cells = workDays_.size() * timeSlots_.size();
+    Occupancy occupancy;
+    occupancy.teacher.assign(teachers_.size() * cells, 0);
+    occupancy.group.assign(groups_.size() * cells, 0);
+    if (ctx.reservedRooms.empty()) occupancy.room.assign(classrooms_.size() * cells, 0);
+    else occupancy.room = ctx.reservedRooms;
+    for (int e : ctx.entries) applyToOccupancy(occupancy, e, placements[e], 1);
+    return occupancy;
+}
+
+bool Scheduler::placeEntry(int entryIdx, const OccupancyView& view, bool allowConflicts, Placement& out,
+                           const std::vector<char>* sharedRooms) const {
+    const auto& rooms = suitableRooms(entryIdx);
+    if (rooms.empty()) return false;
+
+    int numDays = workDays_.size();
+    int numSlots = timeSlots_.size();
+    int cells = numDays * numSlots;
+    int t = entryTeacher_[entryIdx];
+    IndexRange groups = entryGroups_[entryIdx];
+
+    // Pinned rooms of the teacher, subject or groups are preferred, as calculateCost rewards them
+    int teacherPin = t != -1 ? fastTeacherPin_[t] : -1;
+    int subjectPin = entrySubject_[entryIdx] != -1 ? fastSubjectPin_[entrySubject_[entryIdx]] : -1;
+    bool hasPin = teacherPin != -1 || subjectPin != -1;
+    for (int g : groups) if (fastGroupPin_[g] != -1) hasPin = true;
+    auto isPinned = [&](int c) {
+        if (c == teacherPin || c == subjectPin) return true;
+        for (int g : groups) if (fastGroupPin_[g] == c) return true;
+        return false;
+    };
+
+    double bestLocalCost = std::numeric_limits<double>::max();
+    bool found = false;
+
+    for (int d = 0; d < numDays; ++d) {
+        for (int s = 0; s < numSlots; ++s) {
+            int offset = d * numSlots + s;
+            int av = t != -1 ? fastTeacherAvail_[t * cells + offset] : 0;
+            if (av == 3) continue; // Forbidden
+            bool groupForbidden = false;
+            int undesirable = av == 2 ? 1 : 0;
+            for (int g : groups) {
+                int gav = fastGroupAvail_[g * cells + offset];
+                if (gav == 3) groupForbidden = true;
+                else if (gav == 2) undesirable++;
+            }
+            if (groupForbidden) continue;
+
+            int busy = 0;
+            if (t != -1 && view.teacherAt(t * cells + offset) > 0) busy++;
+            for (int g : groups) {
+                if (view.groupAt(g * cells + offset) > 0) busy++;
+            }
+            if (busy && !allowConflicts) continue;
+
+            double slotCost = busy * 10000.0 + undesirable * 20.0;
+
+            for (int c : rooms) {
+                int roomBusy = view.roomAt(c * cells + offset) > 0 ? 1 : 0;
+                if (roomBusy && !allowConflicts) continue;
+
+                double localCost = slotCost + roomBusy * 10000.0;
+                if (hasPin && !isPinned(c)) localCost += 150;
+                if (sharedRooms && (*sharedRooms)[c]) localCost += 1;
+                if (localCost < bestLocalCost) {
+                    bestLocalCost = localCost;
+                    out.day = d;
+                    out.slot = s;
+                    out.room = c;
+                    found = true;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+double Scheduler::entryTerms(int entryIdx, const Placement& p, double penaltyMultiplier,
+                             const std::vector<CompiledRule>* rules, CostBreakdown* cost) const {
+    int d = p.day;
+    int s = p.slot;
+    int c = p.room;
+    int t = entryTeacher_[entryIdx];
+    int cells = workDays_.size() * timeSlots_.size();
+    int offset = d * (int)timeSlots_.size() + s;
+    double hard = 0, availability = 0, pinned = 0, ruleTerms = 0;
+
+    // Availability (using fast lookup)
+    if (t != -1) {
+        int av = fastTeacherAvail_[t * cells + offset];
+        if (av == 2) availability += 20 * penaltyMultiplier; // Undesirable
+        else if (av == 1) availability -= 10 * penaltyMultiplier; // Desirable
+        else if (av == 3) hard += 10000; // Forbidden
+    }
+    for (int g : entryGroups_[entryIdx]) {
+        int av = fastGroupAvail_[g * cells + offset];
+        if (av == 2) availability += 20 * penaltyMultiplier;
+        else if (av == 1) availability -= 10 * penaltyMultiplier;
+        else if (av == 3) hard += 10000;
+    }
+
+    // Pinned Classrooms
+    bool hasPin = false;
+    bool matchPin = false;
+    if (t != -1) {
+        int pin = fastTeacherPin_[t];
+        if (pin != -1) { hasPin = true; if (pin == c) matchPin = true; }
+    }
+    if (entrySubject_[entryIdx] != -1) {
+        int pin = fastSubjectPin_[entrySubject_[entryIdx]];
+        if (pin != -1) { hasPin = true; if (pin == c) matchPin = true; }
+    }
+    for (int g : entryGroups_[entryIdx]) {
+        int pin = fastGroupPin_[g];
+        if (pin != -1) { hasPin = true; if (pin == c) matchPin = true; }
+    }
+    if (hasPin) pinned += matchPin ? -100 * penaltyMultiplier : 50 * penaltyMultiplier;
+
+    // Scheduling Rules: time terms; MaxPerDay depends on the day's other classes
+    if (rules) {
+        for (const CompiledRule& rule : *rules) {
+            if (rule.cell != offset || !rule.applies[entryIdx]) continue;
+            if (rule.action == RuleAction::AvoidTime) ruleTerms += rule.penalty;
+            else if (rule.action == RuleAction::PreferTime) ruleTerms -= rule.penalty;
+        }
+    }
+
+    if (cost) {
+        cost->hardConflicts += hard;
+        cost->availability += availability;
+        cost->pinnedRooms += pinned;
+        cost->rules += ruleTerms;
+    }
+    return hard + availability + pinned + ruleTerms;
+}
+
 double Scheduler::calculateCost(const std::vector<ScheduleEntry>& schedule) {
-    double cost = 0;
-    double penaltyMultiplier = config_.strictness / 5.0;
+    return calculateCost(toPlacements(schedule));
+}
+
+double Scheduler::calculateCost(
+    const std::vector<Placement>& placements,
+    const SolveContext* ctx,
+    CostBreakdown* breakdown,
+    const DistributionTracker* tracker
+) {
+    const Config& config = ctx ? *ctx->config : config_;
+    CostBreakdown cost;
+    double penaltyMultiplier = config.strictness / 5.0;
     int numDays = workDays_.size();
     int numSlots = timeSlots_.size();
     int numTeachers = teachers_.size();
@@ -141,196 +837,538 @@ double Scheduler::calculateCost(const std::vector<ScheduleEntry>& schedule) {
 
     // Flat arrays for usage tracking (much faster than map)
     // Index = entityIdx * (numDays * numSlots) + dayIdx * numSlots + slotIdx
-    std::vector<int> teacherUsage(numTeachers * numDays * numSlots, 0);
-    std::vector<int> groupUsage(numGroups * numDays * numSlots, 0);
-    std::vector<int> roomUsage(numRooms * numDays * numSlots, 0);
+    // Kept per thread and all-zero between calls: a call only touches, and then clears, the
+    // cells of its own entries, so its cost follows the size of the context, not the problem.
+    thread_local std::vector<int> teacherUsage, groupUsage, roomUsage;
+    thread_local std::vector<int> teacherDailyLoad, groupDailyLoad;
+    auto fit = [](std::vector<int>& v, size_t size) { if (v.size() < size) v.resize(size, 0); };
+    fit(teacherUsage, (size_t)numTeachers * numDays * numSlots);
+    fit(groupUsage, (size_t)numGroups * numDays * numSlots);
+    fit(roomUsage, (size_t)numRooms * numDays * numSlots);
+    fit(teacherDailyLoad, (size_t)numTeachers * numDays);
+    fit(groupDailyLoad, (size_t)numGroups * numDays);
 
-    // Daily load tracking
-    std::vector<int> teacherDailyLoad(numTeachers * numDays, 0);
-    std::vector<int> groupDailyLoad(numGroups * numDays, 0);
+    // Weekly distribution, unless the caller maintains it incrementally: a tracker per thread,
+    // emptied again in step 5, so a call neither allocates nor clears problem-sized tables.
+    // It is reused for the model at the same address with the id it was built for: a model
+    // rebuilt in place gets a new id, a copy lives elsewhere.
+    thread_local std::unique_ptr<DistributionTracker> threadTracker;
+    DistributionTracker* localTracker = nullptr;
+    if (!tracker && DistributionTracker::enabled(distributionModel_, config)) {
+        if (!threadTracker || &threadTracker->model() != &distributionModel_
+            || threadTracker->modelId() != distributionModel_.id) {
+            threadTracker.reset(new DistributionTracker(distributionModel_, config));
+        } else {
+            threadTracker->setWeights(config);
+        }
+        localTracker = threadTracker.get();
+    }
 
-    for (const auto& entry : schedule) {
-        if (dIdx_.find(entry.day) == dIdx_.end() || tsIdx_.find(entry.timeSlotId) == tsIdx_.end()) continue;
-        
-        int d = dIdx_.at(entry.day);
-        int s = tsIdx_.at(entry.timeSlotId);
+    // A call that throws before the clearing pass (step 5) wipes the arrays and drops the
+    // tracker instead, so no stale counts reach the next call on this thread
+    struct ClearOnUnwind {
+        std::vector<int>* arrays[5];
+        std::unique_ptr<DistributionTracker>* tracker;
+        bool cleared = false;
+        ~ClearOnUnwind() {
+            if (cleared) return;
+            for (auto* v : arrays) std::fill(v->begin(), v->end(), 0);
+            tracker->reset();
+        }
+    } clearOnUnwind{ { &teacherUsage, &groupUsage, &roomUsage, &teacherDailyLoad, &groupDailyLoad }, &threadTracker };
+    const std::vector<int>* reserved = ctx && !ctx->reservedRooms.empty() ? &ctx->reservedRooms : nullptr;
+
+    // Scheduling rules: compiled here unless the context carries them
+    std::vector<CompiledRule> localRules;
+    const std::vector<CompiledRule>* rules = ctx ? ctx->rules : nullptr;
+    if (!rules && !config.schedulingRules.empty()) {
+        localRules = compileRules(config);
+        rules = &localRules;
+    }
+    // MaxPerDay keys, (rule * keys + key) * numDays + day, one per counted class
+    thread_local std::vector<long long> ruleDays;
+    ruleDays.clear();
+    long long numKeys = std::max<long long>(1, std::max(numTeachers, numGroups));
+
+    size_t count = ctx ? ctx->entries.size() : placements.size();
+    for (size_t k = 0; k < count; ++k) {
+        int i = ctx ? ctx->entries[k] : (int)k;
+        const Placement& p = placements[i];
+        if (p.day < 0 || p.slot < 0) continue;
+        if (localTracker) localTracker->add(i, p);
+
+        int d = p.day;
+        int s = p.slot;
         int offset = d * numSlots + s;
+        int t = entryTeacher_[i];
+        int c = p.room;
 
         // 1. Hard Conflicts & Usage
-        if (tIdx_.count(entry.teacherId)) {
-            int t = tIdx_.at(entry.teacherId);
-            if (++teacherUsage[t * numDays * numSlots + offset] > 1) cost += 10000;
+        if (t != -1) {
+            if (++teacherUsage[t * numDays * numSlots + offset] > 1) cost.hardConflicts += 10000;
             teacherDailyLoad[t * numDays + d]++;
         }
 
-        if (cIdx_.count(entry.classroomId)) {
-            int c = cIdx_.at(entry.classroomId);
-            if (++roomUsage[c * numDays * numSlots + offset] > 1) cost += 10000;
+        if (c != -1) {
+            int cell = c * numDays * numSlots + offset;
+            if (++roomUsage[cell] + (reserved ? (*reserved)[cell] : 0) > 1) cost.hardConflicts += 10000;
         }
 
-        for (const auto& gid : entry.groupIds) {
-            if (gIdx_.count(gid)) {
-                int g = gIdx_.at(gid);
-                if (++groupUsage[g * numDays * numSlots + offset] > 1) cost += 10000;
-                groupDailyLoad[g * numDays + d]++;
+        for (int g : entryGroups_[i]) {
+            if (++groupUsage[g * numDays * numSlots + offset] > 1) cost.hardConflicts += 10000;
+            groupDailyLoad[g * numDays + d]++;
+        }
+
+        // 2-4. Availability, pinned classrooms and time rules of the entry itself
+        entryTerms(i, p, penaltyMultiplier, rules, &cost);
+
+        // MaxPerDay is counted per key and day, charged below
+        if (rules) {
+            for (size_t r = 0; r < rules->size(); ++r) {
+                const CompiledRule& rule = (*rules)[r];
+                if (rule.action != RuleAction::MaxPerDay || !rule.applies[i]) continue;
+                for (int key : rule.keys[i]) ruleDays.push_back(((long long)r * numKeys + key) * numDays + d);
             }
         }
+    }
 
-        // 2. Availability (using fast lookup)
-        if (tIdx_.count(entry.teacherId)) {
-            int t = tIdx_.at(entry.teacherId);
-            int av = fastTeacherAvail_[t][d][s];
-            if (av == 2) cost += 20 * penaltyMultiplier; // Undesirable
-            else if (av == 1) cost -= 10 * penaltyMultiplier; // Desirable
-            else if (av == 3) cost += 10000; // Forbidden
+    // Every class of a key beyond the rule's daily limit is charged, as the TS scheduler
+    // charges each class placed when the limit is already reached
+    if (!ruleDays.empty()) {
+        std::sort(ruleDays.begin(), ruleDays.end());
+        for (size_t a = 0, b = 0; a < ruleDays.size(); a = b) {
+            while (b < ruleDays.size() && ruleDays[b] == ruleDays[a]) ++b;
+            const CompiledRule& rule = (*rules)[ruleDays[a] / numDays / numKeys];
+            if ((long long)(b - a) > rule.param) cost.rules += (b - a - rule.param) * rule.penalty;
         }
-        
-        for (const auto& gid : entry.groupIds) {
-            if (gIdx_.count(gid)) {
-                int g = gIdx_.at(gid);
-                int av = fastGroupAvail_[g][d][s];
-                if (av == 2) cost += 20 * penaltyMultiplier;
-                else if (av == 1) cost -= 10 * penaltyMultiplier;
-                else if (av == 3) cost += 10000;
-            }
+    }
+
+    // 6. Weekly Distribution, read before step 5 empties the per-thread tracker
+    if (tracker) cost.distribution = tracker->penalty();
+    else if (localTracker) cost.distribution = localTracker->penalty();
+
+    // 5. Day Load Limits (using fast daily load); each load is charged once, when it is cleared
+    bool standard = config.settings.enforceStandardRules;
+    for (size_t k = 0; k < count; ++k) {
+        int i = ctx ? ctx->entries[k] : (int)k;
+        const Placement& p = placements[i];
+        if (p.day < 0 || p.slot < 0) continue;
+        if (localTracker) localTracker->remove(i, p);
+        int offset = p.day * numSlots + p.slot;
+        int t = entryTeacher_[i];
+        if (t != -1) {
+            teacherUsage[t * numDays * numSlots + offset] = 0;
+            int& val = teacherDailyLoad[t * numDays + p.day];
+            if (standard) cost.dailyLoad += teacherDayLoadCost(val, penaltyMultiplier);
+            val = 0;
         }
+        if (p.room != -1) roomUsage[p.room * numDays * numSlots + offset] = 0;
+        for (int g : entryGroups_[i]) {
+            groupUsage[g * numDays * numSlots + offset] = 0;
+            int& val = groupDailyLoad[g * numDays + p.day];
+            if (standard) cost.dailyLoad += groupDayLoadCost(val, penaltyMultiplier);
+            val = 0;
+        }
+    }
+    clearOnUnwind.cleared = true;
+
+    cost.total = cost.hardConflicts + cost.availability + cost.pinnedRooms + cost.dailyLoad + cost.distribution
+               + cost.rules;
+    if (breakdown) *breakdown = cost;
+    return cost.total;
+}
+
+std::vector<int> Scheduler::selectNeighborhood(
+    Neighborhood kind,
+    const std::vector<Placement>& placements,
+    const Occupancy& occupancy,
+    const std::vector<int>& placed,
+    const std::vector<double>& typeSaturation,
+    int maxDestroy,
+    std::mt19937& rng
+) const {
+    int numSlots = timeSlots_.size();
+    int cells = workDays_.size() * numSlots;
+    if (placed.empty()) return {};
 
-        // 3. Pinned Classrooms
-        bool hasPin = false;
-        bool matchPin = false;
-        int c = cIdx_.count(entry.classroomId) ? cIdx_.at(entry.classroomId) : -1;
+    std::vector<int> result;
+    int seed = placed[rng() % placed.size()];
 
-        if (tIdx_.count(entry.teacherId)) {
-            int pin = fastTeacherPin_[tIdx_.at(entry.teacherId)];
-            if (pin != -1) { hasPin = true; if (pin == c) matchPin = true; }
+    switch (kind) {
+    case Neighborhood::GroupDay: {
+        // Whole day of one group
+        if (entryGroups_[seed].empty()) break;
+        int g = entryGroups_[seed][rng() % entryGroups_[seed].size()];
+        for (int e : groupEntries_[g]) {
+            if (placements[e].day == placements[seed].day) result.push_back(e);
         }
-        if (sIdx_.count(entry.subjectId)) {
-            int pin = fastSubjectPin_[sIdx_.at(entry.subjectId)];
-            if (pin != -1) { hasPin = true; if (pin == c) matchPin = true; }
+        break;
+    }
+    case Neighborhood::Teacher: {
+        // Whole week of one teacher
+        int t = entryTeacher_[seed];
+        if (t == -1) break;
+        for (int e : teacherEntries_[t]) {
+            if (placements[e].day >= 0) result.push_back(e);
         }
-        for (const auto& gid : entry.groupIds) {
-            if (gIdx_.count(gid)) {
-                int pin = fastGroupPin_[gIdx_.at(gid)];
-                if (pin != -1) { hasPin = true; if (pin == c) matchPin = true; }
-            }
+        break;
+    }
+    case Neighborhood::RoomType: {
+        // Entries in rooms of one type, picked proportionally to how saturated the type is
+        if (numRoomTypes_ == 0) break;
+        double total = 0;
+        for (double load : typeSaturation) total += load;
+        if (total <= 0) break;
+
+        double pick = std::uniform_real_distribution<double>(0.0, total)(rng);
+        int bottleneck = numRoomTypes_ - 1;
+        for (int type = 0; type < numRoomTypes_; ++type) {
+            pick -= typeSaturation[type];
+            if (pick <= 0) { bottleneck = type; break; }
+        }
+        for (int e : placed) {
+            if (placements[e].room >= 0 && classroomType_[placements[e].room] == bottleneck) result.push_back(e);
         }
-        if (hasPin) cost += matchPin ? -100 * penaltyMultiplier : 50 * penaltyMultiplier;
+        break;
     }
+    case Neighborhood::Conflict: {
+        // Entries sitting on an overbooked teacher/group/room cell
+        auto isConflicted = [&](int e) {
+            const Placement& p = placements[e];
+            int offset = p.day * numSlots + p.slot;
+            int t = entryTeacher_[e];
+            if (t != -1 && occupancy.teacher[t * cells + offset] > 1) return true;
+            if (p.room != -1 && occupancy.room[p.room * cells + offset] > 1) return true;
+            for (int g : entryGroups_[e]) {
+                if (occupancy.group[g * cells + offset] > 1) return true;
+            }
+            return false;
+        };
+        std::vector<int> conflicted;
+        for (int e : placed) {
+            if (isConflicted(e)) conflicted.push_back(e);
+        }
+        if (!conflicted.empty()) seed = conflicted[rng() % conflicted.size()];
 
-    // 4. Day Load Limits (using fast daily load)
-    if (config_.settings.enforceStandardRules) {
-        for (int val : teacherDailyLoad) {
-            if (val >= 4) cost += (val - 3) * 150 * penaltyMultiplier;
+        // Everything sharing a resource with the seed on its day, then more conflicted entries
+        const Placement& sp = placements[seed];
+        for (int e : placed) {
+            if (placements[e].day != sp.day) continue;
+            bool shares = entryTeacher_[e] != -1 && entryTeacher_[e] == entryTeacher_[seed];
+            if (!shares && placements[e].slot == sp.slot && sp.room != -1 && placements[e].room == sp.room) shares = true;
+            for (int g : entryGroups_[e]) {
+                for (int sg : entryGroups_[seed]) if (g == sg) shares = true;
+            }
+            if (shares) result.push_back(e);
         }
-        for (int val : groupDailyLoad) {
-            if (val >= 5) cost += (val - 4) * 200 * penaltyMultiplier;
-            else if (val >= 4) cost += (val - 3) * 100 * penaltyMultiplier;
+        std::shuffle(conflicted.begin(), conflicted.end(), rng);
+        for (int e : conflicted) {
+            if ((int)result.size() >= maxDestroy) break;
+            result.push_back(e);
         }
+        break;
+    }
     }
 
+    if (result.empty()) result.push_back(seed);
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    if ((int)result.size() > maxDestroy) {
+        std::shuffle(result.begin(), result.end(), rng);
+        result.resize(maxDestroy);
+    }
+    return result;
+}
+
+double Scheduler::lnsObjective(const std::vector<Placement>& placements, const SolveContext& ctx) {
+    // Dropping an entry must never look cheaper than keeping it with a conflict
+    double cost = calculateCost(placements, &ctx);
+    for (int e : ctx.entries) {
+        if (placements[e].day < 0 && !suitableRooms(e).empty()) cost += 10000;
+    }
     return cost;
 }
 
-std::vector<ScheduleEntry> Scheduler::solve() {
-    std::vector<ScheduleEntry> currentSchedule;
-    std::vector<UnscheduledEntry> sortedEntries = entries_;
+void Scheduler::applyToTotals(LnsTotals& totals, int entryIdx, const Placement& p, int delta,
+                              const std::vector<CompiledRule>& rules) const {
+    if (p.day < 0) return;
+    int numDays = workDays_.size();
+    int t = entryTeacher_[entryIdx];
+    if (t != -1) totals.teacherDayLoad[t * numDays + p.day] += delta;
+    for (int g : entryGroups_[entryIdx]) totals.groupDayLoad[g * numDays + p.day] += delta;
+    if (p.room != -1) totals.roomTypeLoad[classroomType_[p.room]] += delta;
+    if (totals.ruleDayCount.empty()) return;
+    long long numKeys = std::max<long long>(1, std::max(teachers_.size(), groups_.size()));
+    for (size_t r = 0; r < rules.size(); ++r) {
+        if (rules[r].action != RuleAction::MaxPerDay || !rules[r].applies[entryIdx]) continue;
+        for (int key : rules[r].keys[entryIdx]) totals.ruleDayCount[((long long)r * numKeys + key) * numDays + p.day] += delta;
+    }
+}
 
-    // Sort entries
-    std::sort(sortedEntries.begin(), sortedEntries.end(), [&](const UnscheduledEntry& a, const UnscheduledEntry& b) {
-        return a.studentCount > b.studentCount; 
+double Scheduler::repairDelta(
+    const std::vector<int>& entries,
+    const std::vector<Placement>& placements,
+    const std::vector<Placement>& current,
+    const OccupancyView& view,
+    const LnsTotals& totals,
+    const SolveContext& ctx,
+    const std::vector<CompiledRule>& rules,
+    DistributionTracker* tracker
+) const {
+    const Config& config = *ctx.config;
+    double penaltyMultiplier = config.strictness / 5.0;
+    bool standard = config.settings.enforceStandardRules;
+    int numDays = workDays_.size();
+    long long numKeys = std::max<long long>(1, std::max(teachers_.size(), groups_.size()));
+    double delta = 0;
+
+    // Double bookings, only on the cells the attempt touched
+    const Occupancy& base = *view.base;
+    for (const auto& cell : view.teacher) delta += overbookingCost(base.teacher[cell.first] + cell.second) - overbookingCost(base.teacher[cell.first]);
+    for (const auto& cell : view.group) delta += overbookingCost(base.group[cell.first] + cell.second) - overbookingCost(base.group[cell.first]);
+    for (const auto& cell : view.room) delta += overbookingCost(base.room[cell.first] + cell.second) - overbookingCost(base.room[cell.first]);
+
+    // Per-entry terms out with the old cells and in with the new ones; day loads and MaxPerDay
+    // counts are collected as (key, change) and settled per key below
+    thread_local std::vector<std::pair<long long, int>> teacherDays, groupDays, ruleDays;
+    teacherDays.clear();
+    groupDays.clear();
+    ruleDays.clear();
+    double distributionBefore = tracker ? tracker->penalty() : 0;
+    auto move = [&](int e, const Placement& p, int sign) {
+        if (p.day < 0) {
+            // Dropping an entry must never look cheaper than keeping it with a conflict
+            if (!suitableRooms(e).empty()) delta += sign * 10000.0;
+            return;
+        }
+        delta += sign * entryTerms(e, p, penaltyMultiplier, &rules, nullptr);
+        int t = entryTeacher_[e];
+        if (t != -1) teacherDays.emplace_back((long long)t * numDays + p.day, sign);
+        for (int g : entryGroups_[e]) groupDays.emplace_back((long long)g * numDays + p.day, sign);
+        if (!totals.ruleDayCount.empty()) {
+            for (size_t r = 0; r < rules.size(); ++r) {
+                if (rules[r].action != RuleAction::MaxPerDay || !rules[r].applies[e]) continue;
+                for (int key : rules[r].keys[e]) ruleDays.emplace_back(((long long)r * numKeys + key) * numDays + p.day, sign);
+            }
+        }
+        if (tracker) {
+            if (sign > 0) tracker->add(e, p);
+            else tracker->remove(e, p);
+        }
+    };
+    for (size_t k = 0; k < entries.size(); ++k) move(entries[k], current[entries[k]], -1);
+    for (size_t k = 0; k < entries.size(); ++k) move(entries[k], placements[k], 1);
+
+    auto settle = [&](std::vector<std::pair<long long, int>>& changes, const std::vector<int>& counts, auto cost) {
+        std::sort(changes.begin(), changes.end());
+        for (size_t a = 0, b = 0; a < changes.size(); a = b) {
+            int change = 0;
+            while (b < changes.size() && changes[b].first == changes[a].first) change += changes[b++].second;
+            if (change == 0) continue;
+            int before = counts[changes[a].first];
+            delta += cost(changes[a].first, before + change) - cost(changes[a].first, before);
+        }
+    };
+    if (standard) {
+        settle(teacherDays, totals.teacherDayLoad, [&](long long, int load) { return teacherDayLoadCost(load, penaltyMultiplier); });
+        settle(groupDays, totals.groupDayLoad, [&](long long, int load) { return groupDayLoadCost(load, penaltyMultiplier); });
+    }
+    settle(ruleDays, totals.ruleDayCount, [&](long long key, int count) {
+        const CompiledRule& rule = rules[key / numDays / numKeys];
+        return count > rule.param ? (count - rule.param) * rule.penalty : 0.0;
     });
 
-    // --- PHASE 1: GREEDY INITIALIZATION ---
-    // (Simplified for brevity, but using fast lookups would be better. 
-    //  For now, keeping logic similar but using pre-calc rooms)
-    
-    for (size_t i = 0; i < sortedEntries.size(); ++i) {
-        const auto& entry = sortedEntries[i];
-        if (entrySuitableRooms_[i].empty()) continue;
-
-        double bestLocalCost = std::numeric_limits<double>::max();
-        ScheduleEntry bestEntry;
-        bool found = false;
-
-        // Try random subset of slots/rooms to speed up greedy
-        // Or just iterate all. With integer math it's fast.
-        for (size_t d = 0; d < workDays_.size(); ++d) {
-            for (size_t s = 0; s < timeSlots_.size(); ++s) {
-                // Quick check teacher availability
-                if (tIdx_.count(entry.teacherId)) {
-                    int t = tIdx_.at(entry.teacherId);
-                    if (fastTeacherAvail_[t][d][s] == 3) continue; // Forbidden
-                }
+    // The tracker saw the attempt; read its penalty and put `current` back
+    if (tracker) {
+        delta += tracker->penalty() - distributionBefore;
+        for (size_t k = 0; k < entries.size(); ++k) {
+            tracker->remove(entries[k], placements[k]);
+            tracker->add(entries[k], current[entries[k]]);
+        }
+    }
+    return delta;
+}
 
-                for (int c : entrySuitableRooms_[i]) {
-                    // Check simple conflicts in current schedule
-                    bool conflict = false;
-                    for(const auto& sch : currentSchedule) {
-                        if (sch.day == workDays_[d] && sch.timeSlotId == timeSlots_[s].id) {
-                            if (sch.teacherId == entry.teacherId || sch.classroomId == classrooms_[c].id) {
-                                conflict = true; break;
-                            }
-                            for(const auto& g : entry.groupIds) {
-                                for(const auto& sg : sch.groupIds) if (g == sg) { conflict = true; break; }
-                            }
-                        }
-                        if (conflict) break;
-                    }
-                    if (conflict) continue;
+std::vector<Placement> Scheduler::runLns(const std::vector<Placement>& initial, const SolveContext& ctx) {
+    const LnsSettings& lns = ctx.config->lns;
+    int workers = std::max(1, lns.parallelRepairs);
+    double fraction = std::isfinite(lns.destroyFraction) ? std::min(std::max(lns.destroyFraction, 0.0), 1.0) : 0.1;
+    int maxDestroy = std::max(4, (int)(fraction * ctx.entries.size()));
+    int numDays = workDays_.size();
+    int cells = numDays * timeSlots_.size();
 
-                    double localCost = 0;
-                    // Add preference cost
-                    if (tIdx_.count(entry.teacherId)) {
-                         int av = fastTeacherAvail_[tIdx_.at(entry.teacherId)][d][s];
-                         if (av == 2) localCost += 20;
-                    }
+    std::vector<CompiledRule> localRules;
+    const std::vector<CompiledRule>* rules = ctx.rules;
+    if (!rules) {
+        localRules = compileRules(*ctx.config);
+        rules = &localRules;
+    }
+    bool maxPerDay = false;
+    for (const auto& rule : *rules) maxPerDay = maxPerDay || rule.action == RuleAction::MaxPerDay;
 
-                    if (localCost < bestLocalCost) {
-                        bestLocalCost = localCost;
-                        bestEntry.id = "sched-" + entry.uid;
-                        bestEntry.day = workDays_[d];
-                        bestEntry.timeSlotId = timeSlots_[s].id;
-                        bestEntry.classroomId = classrooms_[c].id;
-                        bestEntry.subjectId = entry.subjectId;
-                        bestEntry.teacherId = entry.teacherId;
-                        bestEntry.groupIds = entry.groupIds;
-                        bestEntry.classType = entry.classType;
-                        bestEntry.unscheduledUid = entry.uid;
-                        found = true;
-                    }
+    // The accepted solution, its occupancy and totals are only read by the workers during a
+    // round and are updated in place between rounds. Each repair attempt records a sparse
+    // occupancy delta on top of them and is scored from that delta (repairDelta), so an
+    // attempt costs O(entries it moves), not O(entries of the context).
+    std::vector<Placement> current = initial;
+    Occupancy currentOcc = buildOccupancy(initial, ctx);
+    LnsTotals totals;
+    totals.teacherDayLoad.assign(teachers_.size() * numDays, 0);
+    totals.groupDayLoad.assign(groups_.size() * numDays, 0);
+    totals.roomTypeLoad.assign(numRoomTypes_, 0);
+    if (maxPerDay) {
+        totals.ruleDayCount.assign(rules->size() * std::max(teachers_.size(), groups_.size()) * numDays, 0);
+    }
+    for (int e : ctx.entries) applyToTotals(totals, e, current[e], 1, *rules);
+    std::vector<int> roomsOfType(numRoomTypes_, 0);
+    for (int type : classroomType_) roomsOfType[type]++;
+
+    double currentCost = lnsObjective(current, ctx);
+    std::vector<Placement> best = current;
+    double bestCost = currentCost;
+
+    unsigned int baseSeed = (unsigned int)std::chrono::steady_clock::now().time_since_epoch().count();
+    std::mt19937 acceptRng(baseSeed);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    double temperature = 1000.0;
+    double coolingRate = 0.99;
+
+    const std::vector<char>* sharedRooms = ctx.sharedRooms.empty() ? nullptr : &ctx.sharedRooms;
+
+    struct RepairAttempt {
+        std::vector<int> entries;
+        std::vector<Placement> placements;
+        std::unique_ptr<DistributionTracker> tracker; // holds `current` between rounds
+        double cost = std::numeric_limits<double>::max();
+    };
+    std::vector<RepairAttempt> attempts(workers);
+    if (DistributionTracker::enabled(distributionModel_, *ctx.config)) {
+        for (auto& attempt : attempts) {
+            attempt.tracker.reset(new DistributionTracker(distributionModel_, *ctx.config));
+            for (int e : ctx.entries) attempt.tracker->add(e, current[e]);
+        }
+    }
+
+    std::vector<int> placed, unplaced;
+    std::vector<double> typeSaturation(numRoomTypes_, 0.0);
+    for (int it = 0; it < lns.iterations; ++it) {
+        if (std::chrono::steady_clock::now() > ctx.deadline) break;
+
+        // Inputs shared by the round's attempts
+        placed.clear();
+        unplaced.clear();
+        for (int e : ctx.entries) {
+            if (current[e].day >= 0) placed.push_back(e);
+            else if (!suitableRooms(e).empty()) unplaced.push_back(e);
+        }
+        for (int type = 0; type < numRoomTypes_; ++type) {
+            typeSaturation[type] = roomsOfType[type] ? (double)totals.roomTypeLoad[type] / (roomsOfType[type] * cells) : 0.0;
+        }
+
+        #pragma omp parallel for num_threads(std::min(workers, ctx.threads))
+        for (int w = 0; w < workers; ++w) {
+            std::mt19937 rng(baseSeed + it * 7919u + w * 777u);
+            RepairAttempt& attempt = attempts[w];
+
+            // Destroy
+            Neighborhood kind = static_cast<Neighborhood>(rng() % 4);
+            attempt.entries = selectNeighborhood(kind, current, currentOcc, placed, typeSaturation, maxDestroy, rng);
+            OccupancyView view;
+            view.base = &currentOcc;
+            for (int e : attempt.entries) applyToView(view, e, current[e], -1);
+
+            // Repair, most constrained entries first
+            attempt.entries.insert(attempt.entries.end(), unplaced.begin(), unplaced.end());
+            std::shuffle(attempt.entries.begin(), attempt.entries.end(), rng);
+            std::stable_sort(attempt.entries.begin(), attempt.entries.end(), [&](int a, int b) {
+                return suitableRooms(a).size() < suitableRooms(b).size();
+            });
+            attempt.placements.assign(attempt.entries.size(), Placement());
+            for (size_t k = 0; k < attempt.entries.size(); ++k) {
+                Placement p;
+                if (!placeEntry(attempt.entries[k], view, true, p, sharedRooms)) continue;
+                attempt.placements[k] = p;
+                applyToView(view, attempt.entries[k], p, 1);
+            }
+
+            attempt.cost = currentCost + repairDelta(attempt.entries, attempt.placements, current, view,
+                                                     totals, ctx, *rules, attempt.tracker.get());
+        }
+
+        int bestAttempt = 0;
+        for (int w = 1; w < workers; ++w) {
+            if (attempts[w].cost < attempts[bestAttempt].cost) bestAttempt = w;
+        }
+        const RepairAttempt& chosen = attempts[bestAttempt];
+
+        bool accept;
+        if (lns.acceptance == LnsAcceptance::RecordToRecord) {
+            accept = chosen.cost <= bestCost + lns.recordDeviation * std::max(1.0, std::abs(bestCost));
+        } else {
+            double delta = chosen.cost - currentCost;
+            accept = delta < 0 || std::exp(-delta / temperature) > dist(acceptRng);
+        }
+
+        if (accept) {
+            for (size_t k = 0; k < chosen.entries.size(); ++k) {
+                int e = chosen.entries[k];
+                const Placement& p = chosen.placements[k];
+                for (auto& attempt : attempts) {
+                    if (!attempt.tracker) break;
+                    attempt.tracker->remove(e, current[e]);
+                    attempt.tracker->add(e, p);
                 }
+                applyToOccupancy(currentOcc, e, current[e], -1);
+                applyToTotals(totals, e, current[e], -1, *rules);
+                current[e] = p;
+                applyToOccupancy(currentOcc, e, current[e], 1);
+                applyToTotals(totals, e, current[e], 1, *rules);
+            }
+            currentCost = chosen.cost;
+            if (currentCost < bestCost) {
+                for (int e : ctx.entries) best[e] = current[e];
+                bestCost = currentCost;
+                if (ctx.stream) ctx.stream->offer(ctx.part, ctx.entries, best, bestCost);
             }
         }
-        if (found) currentSchedule.push_back(bestEntry);
+        temperature *= coolingRate;
     }
 
-    // --- PHASE 2: PARALLEL SIMULATED ANNEALING ---
-    if (currentSchedule.empty()) return currentSchedule;
+    return best;
+}
 
-    // Number of parallel chains
-    int num_chains = 1;
-    #ifdef _OPENMP
-    num_chains = omp_get_max_threads();
-    // Clamp to reasonable number (e.g., 4-8) to avoid overhead if many cores
-    if (num_chains > 8) num_chains = 8;
-    if (num_chains < 1) num_chains = 1;
-    #endif
+std::vector<Placement> Scheduler::runAnnealing(const std::vector<Placement>& initial, const SolveContext& ctx) {
+    std::vector<int> placed;
+    for (int e : ctx.entries) {
+        if (initial[e].day >= 0) placed.push_back(e);
+    }
+    if (placed.empty()) return initial;
 
-    std::vector<std::vector<ScheduleEntry>> results(num_chains);
+    // Number of parallel chains, clamped to a reasonable number (e.g., 4-8) to avoid overhead
+    int num_chains = std::max(1, std::min(ctx.threads, 8));
+
+    std::vector<std::vector<Placement>> results(num_chains);
     std::vector<double> costs(num_chains);
 
-    #pragma omp parallel for
+    #pragma omp parallel for num_threads(num_chains)
     for (int chain = 0; chain < num_chains; ++chain) {
         // Each thread gets its own copy and PRNG
-        std::vector<ScheduleEntry> localSchedule = currentSchedule;
+        std::vector<Placement> localPlacements = initial;
         
         // Seed with time + chain id to ensure diversity
         unsigned int seed = (unsigned int)(std::chrono::steady_clock::now().time_since_epoch().count() + chain * 777);
         std::mt19937 rng(seed);
         std::uniform_real_distribution<double> dist(0.0, 1.0);
 
-        double currentCost = calculateCost(localSchedule);
-        std::vector<ScheduleEntry> bestLocalSchedule = localSchedule;
+        // Distribution terms are kept up to date move by move instead of being rebuilt
+        std::unique_ptr<DistributionTracker> tracker;
+        if (DistributionTracker::enabled(distributionModel_, *ctx.config)) {
+            tracker.reset(new DistributionTracker(distributionModel_, *ctx.config));
+            for (int e : ctx.entries) tracker->add(e, localPlacements[e]);
+        }
+
+        double currentCost = calculateCost(localPlacements, &ctx, nullptr, tracker.get());
+        std::vector<Placement> bestLocalPlacements = localPlacements;
         double bestLocalCost = currentCost;
 
         double temperature = 1000.0;
@@ -338,44 +1376,36 @@ std::vector<ScheduleEntry> Scheduler::solve() {
         int iterations = 5000; // Fewer iterations per chain, but parallel
 
         for (int i = 0; i < iterations; ++i) {
-            std::vector<ScheduleEntry> neighbor = localSchedule;
-            
-            // Mutation
-            if (neighbor.empty()) break;
-            int idx = rng() % neighbor.size();
-            ScheduleEntry& e = neighbor[idx];
-
-            // Move to random slot/room
-            int d = rng() % workDays_.size();
-            int s = rng() % timeSlots_.size();
-            e.day = workDays_[d];
-            e.timeSlotId = timeSlots_[s].id;
-
-            // Find mapping back to entry index to get suitable rooms
-            // Optimization: Store entry index in ScheduleEntry? 
-            // For now, linear scan or just pick random room (less safe but fast)
-            // Let's pick random room from ALL rooms, cost function handles validity
-            // Better: pick from pre-calculated suitable list if possible.
-            // We don't have easy link back to `entries_` index here.
-            // Fallback: pick random room.
-            int r = rng() % classrooms_.size();
-            e.classroomId = classrooms_[r].id;
-
-            double neighborCost = calculateCost(neighbor);
+            if ((i & 63) == 0 && std::chrono::steady_clock::now() > ctx.deadline) break;
+
+            // Mutation: move a random entry to a random slot/room, undone if rejected.
+            // The room is picked from ALL rooms; the cost function handles validity.
+            int idx = placed[rng() % placed.size()];
+            Placement previous = localPlacements[idx];
+            Placement& p = localPlacements[idx];
+            p.day = rng() % workDays_.size();
+            p.slot = rng() % timeSlots_.size();
+            p.room = rng() % classrooms_.size();
+            if (tracker) { tracker->remove(idx, previous); tracker->add(idx, p); }
+
+            double neighborCost = calculateCost(localPlacements, &ctx, nullptr, tracker.get());
             double delta = neighborCost - currentCost;
 
             if (delta < 0 || std::exp(-delta / temperature) > dist(rng)) {
-                localSchedule = neighbor;
                 currentCost = neighborCost;
                 if (currentCost < bestLocalCost) {
                     bestLocalCost = currentCost;
-                    bestLocalSchedule = localSchedule;
+                    bestLocalPlacements = localPlacements;
+                    if (ctx.stream) ctx.stream->offer(ctx.part, ctx.entries, bestLocalPlacements, bestLocalCost);
                 }
+            } else {
+                if (tracker) { tracker->remove(idx, p); tracker->add(idx, previous); }
+                p = previous;
             }
             temperature *= coolingRate;
         }
         
-        results[chain] = bestLocalSchedule;
+        results[chain] = bestLocalPlacements;
         costs[chain] = bestLocalCost;
     }
 
@@ -387,3 +1417,397 @@ std::vector<ScheduleEntry> Scheduler::solve() {
 
     return results[bestChain];
 }
+
+std::vector<Placement> Scheduler::solveContext(const SolveContext& ctx) {
+    // Sort entries
+    std::vector<int> order = ctx.entries;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return entries_[a].studentCount > entries_[b].studentCount;
+    });
+
+    // --- PHASE 1: GREEDY INITIALIZATION ---
+    std::vector<Placement> placements(entries_.size());
+    Occupancy occupancy = buildOccupancy(placements, ctx);
+    OccupancyView view;
+    view.base = &occupancy;
+
+    const std::vector<char>* sharedRooms = ctx.sharedRooms.empty() ? nullptr : &ctx.sharedRooms;
+    for (int e : order) {
+        Placement p;
+        if (!placeEntry(e, view, false, p, sharedRooms)) continue;
+        placements[e] = p;
+        applyToOccupancy(occupancy, e, p, 1);
+    }
+
+    // The greedy solution is the first usable draft
+    if (ctx.stream) {
+        double cost = ctx.config->lns.enabled ? lnsObjective(placements, ctx) : calculateCost(placements, &ctx);
+        ctx.stream->offer(ctx.part, ctx.entries, placements, cost);
+    }
+
+    // --- PHASE 2: PARALLEL SIMULATED ANNEALING (or LARGE NEIGHBORHOOD SEARCH) ---
+    if (ctx.config->lns.enabled) return runLns(placements, ctx);
+    return runAnnealing(placements, ctx);
+}
+
+std::vector<Scheduler::SolveContext> Scheduler::decompose(const Config& config, int threads) {
+    int n = entries_.size();
+    int cells = workDays_.size() * timeSlots_.size();
+    int numRooms = classrooms_.size();
+
+    SolveContext whole;
+    whole.entries.resize(n);
+    for (int i = 0; i < n; ++i) whole.entries[i] = i;
+    whole.threads = threads;
+    whole.config = &config;
+    if (!config.decomposition.enabled || n == 0) return { whole };
+
+    // Union-find with path halving
+    auto find = [](std::vector<int>& parent, int x) {
+        while (parent[x] != x) x = parent[x] = parent[parent[x]];
+        return x;
+    };
+
+    // 1. Entries sharing a teacher or a group are strongly coupled
+    std::vector<int> entryParent(n);
+    for (int i = 0; i < n; ++i) entryParent[i] = i;
+    auto uniteAll = [&](const IndexLists& lists) {
+        for (size_t l = 0; l < lists.size(); ++l) {
+            IndexRange list = lists[l];
+            for (size_t k = 1; k < list.size(); ++k) {
+                entryParent[find(entryParent, list[k])] = find(entryParent, list[0]);
+            }
+        }
+    };
+    uniteAll(teacherEntries_);
+    uniteAll(groupEntries_);
+
+    std::unordered_map<int, int> rootCluster;
+    std::vector<std::vector<int>> clusterEntries;
+    for (int i = 0; i < n; ++i) {
+        int root = find(entryParent, i);
+        auto it = rootCluster.find(root);
+        if (it == rootCluster.end()) {
+            it = rootCluster.emplace(root, (int)clusterEntries.size()).first;
+            clusterEntries.emplace_back();
+        }
+        clusterEntries[it->second].push_back(i);
+    }
+    int numClusters = clusterEntries.size();
+    if (numClusters == 1) return { whole };
+
+    // 2. Clusters are weakly coupled through suitable rooms; merge the ones competing for most of them
+    std::vector<std::vector<int>> clusterRooms(numClusters);
+    std::vector<std::vector<int>> roomClusters(numRooms);
+    for (int k = 0; k < numClusters; ++k) {
+        std::vector<char> used(numRooms, 0);
+        for (int e : clusterEntries[k]) {
+            for (int c : suitableRooms(e)) used[c] = 1;
+        }
+        for (int c = 0; c < numRooms; ++c) {
+            if (!used[c]) continue;
+            clusterRooms[k].push_back(c);
+            roomClusters[c].push_back(k);
+        }
+    }
+
+    // Overlaps are counted per cluster pair through the rooms they share. Rooms wanted by more
+    // than kMaxRoomUsers clusters are common pools: they are only split by demand below and do
+    // not merge clusters, which bounds this pass to O(rooms * kMaxRoomUsers^2).
+    const size_t kMaxRoomUsers = 64;
+    std::vector<int> clusterParent(numClusters);
+    for (int k = 0; k < numClusters; ++k) clusterParent[k] = k;
+    std::vector<int> shared(numClusters, 0);
+    std::vector<int> touched;
+    for (int a = 0; a < numClusters; ++a) {
+        for (int c : clusterRooms[a]) {
+            if (roomClusters[c].size() > kMaxRoomUsers) continue;
+            for (int b : roomClusters[c]) {
+                if (b > a && shared[b]++ == 0) touched.push_back(b);
+            }
+        }
+        for (int b : touched) {
+            size_t smaller = std::min(clusterRooms[a].size(), clusterRooms[b].size());
+            if (shared[b] > config.decomposition.maxRoomOverlap * smaller) {
+                clusterParent[find(clusterParent, a)] = find(clusterParent, b);
+            }
+            shared[b] = 0;
+        }
+        touched.clear();
+    }
+
+    std::unordered_map<int, int> rootPart;
+    std::vector<std::vector<int>> parts;
+    for (int k = 0; k < numClusters; ++k) {
+        int root = find(clusterParent, k);
+        auto it = rootPart.find(root);
+        if (it == rootPart.end()) {
+            it = rootPart.emplace(root, (int)parts.size()).first;
+            parts.emplace_back();
+        }
+        auto& part = parts[it->second];
+        part.insert(part.end(), clusterEntries[k].begin(), clusterEntries[k].end());
+    }
+    if (parts.size() == 1) return { whole };
+
+    // 3. Pack parts into at most `threads` contexts, largest first into the least loaded one.
+    // Each context reserves its own copy of the room cells (rooms * cells ints, copied again
+    // into its occupancy), so the count is also capped by kMaxContexts and a cell budget.
+    const int kMaxContexts = 16;
+    const long long kMaxReservedCells = 1LL << 24;
+    long long roomCells = std::max<long long>(1, (long long)numRooms * cells);
+    int maxContexts = (int)std::min<long long>(kMaxContexts, kMaxReservedCells / roomCells);
+    std::sort(parts.begin(), parts.end(), [](const std::vector<int>& a, const std::vector<int>& b) {
+        return a.size() > b.size();
+    });
+    int numContexts = std::max(1, std::min({ threads, (int)parts.size(), maxContexts }));
+    std::vector<SolveContext> contexts(numContexts);
+    for (const auto& part : parts) {
+        int target = 0;
+        for (int k = 1; k < numContexts; ++k) {
+            if (contexts[k].entries.size() < contexts[target].entries.size()) target = k;
+        }
+        contexts[target].entries.insert(contexts[target].entries.end(), part.begin(), part.end());
+    }
+    if (numContexts == 1) return { whole };
+
+    // 4. Thread budget proportional to the context size
+    for (auto& ctx : contexts) {
+        ctx.config = &config;
+        ctx.threads = std::max(1, (int)std::lround((double)threads * ctx.entries.size() / n));
+    }
+
+    // 5. Partition every room's cells between contexts, proportionally to each one's demand.
+    // An entry's demand is spread evenly over its suitable rooms; rooms nobody needs are split
+    // evenly, as annealing moves may still land there. Cells a context leaves unused go back
+    // to the others in placeLeftovers().
+    std::vector<std::vector<double>> demand(numContexts, std::vector<double>(numRooms, 0.0));
+    for (int k = 0; k < numContexts; ++k) {
+        for (int e : contexts[k].entries) {
+            const auto& rooms = suitableRooms(e);
+            for (int c : rooms) demand[k][c] += 1.0 / rooms.size();
+        }
+        contexts[k].reservedRooms.assign(numRooms * cells, 0);
+    }
+
+    for (int c = 0; c < numRooms; ++c) {
+        std::vector<int> users;
+        std::vector<double> share;
+        for (int k = 0; k < numContexts; ++k) {
+            if (demand[k][c] > 0) { users.push_back(k); share.push_back(demand[k][c]); }
+        }
+        if (users.empty()) {
+            for (int k = 0; k < numContexts; ++k) { users.push_back(k); share.push_back(1.0); }
+        }
+        if (users.size() > 1) {
+            for (int k : users) {
+                if (contexts[k].sharedRooms.empty()) contexts[k].sharedRooms.assign(numRooms, 0);
+                contexts[k].sharedRooms[c] = 1;
+            }
+        }
+
+        // Stride scheduling spreads each context's share over the whole week
+        std::vector<double> pass(users.size(), 0.0);
+        for (int cell = 0; cell < cells; ++cell) {
+            size_t owner = 0;
+            for (size_t u = 1; u < users.size(); ++u) {
+                if (pass[u] < pass[owner]) owner = u;
+            }
+            pass[owner] += 1.0 / share[owner];
+
+            for (int k = 0; k < numContexts; ++k) {
+                if (k != users[owner]) contexts[k].reservedRooms[c * cells + cell] = 1;
+            }
+        }
+    }
+
+    return contexts;
+}
+
+std::vector<Placement> Scheduler::solvePlacements(const Config& config, int threads, SnapshotStream* stream) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<SolveContext> contexts = decompose(config, threads);
+    std::vector<CompiledRule> compiled;
+    const std::vector<CompiledRule>& rules = rulesFor(config, compiled);
+    if (config.timeLimitSeconds > 0) {
+        auto budget = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(config.timeLimitSeconds));
+        for (auto& ctx : contexts) ctx.deadline = start + budget;
+    }
+    for (size_t k = 0; k < contexts.size(); ++k) {
+        contexts[k].part = k;
+        contexts[k].stream = stream;
+        contexts[k].rules = &rules;
+    }
+    if (stream) stream->begin(entries_.size(), contexts.size());
+    if (contexts.size() == 1) return solveContext(contexts[0]);
+
+    // Independent parts run concurrently, each with its own nested thread budget.
+    // Entry sets are disjoint, so parts write their results straight into the merged vector.
+    std::vector<Placement> merged(entries_.size());
+    #pragma omp parallel for schedule(dynamic) num_threads((int)contexts.size())
+    for (int k = 0; k < (int)contexts.size(); ++k) {
+        std::vector<Placement> partial = solveContext(contexts[k]);
+        for (int e : contexts[k].entries) merged[e] = partial[e];
+    }
+    placeLeftovers(merged);
+    return merged;
+}
+
+void Scheduler::placeLeftovers(std::vector<Placement>& placements) const {
+    int numSlots = timeSlots_.size();
+    int cells = workDays_.size() * numSlots;
+
+    std::vector<int> leftovers;
+    for (size_t e = 0; e < entries_.size(); ++e) {
+        if (placements[e].day < 0 && !suitableRooms(e).empty()) leftovers.push_back(e);
+    }
+    if (leftovers.empty()) return;
+    std::stable_sort(leftovers.begin(), leftovers.end(), [&](int a, int b) {
+        return suitableRooms(a).size() < suitableRooms(b).size();
+    });
+
+    SolveContext whole;
+    whole.entries.resize(entries_.size());
+    for (size_t i = 0; i < entries_.size(); ++i) whole.entries[i] = i;
+    Occupancy occupancy = buildOccupancy(placements, whole);
+    OccupancyView view;
+    view.base = &occupancy;
+    std::vector<int> roomOwner(classrooms_.size() * cells, -1);
+    for (size_t e = 0; e < entries_.size(); ++e) {
+        const Placement& p = placements[e];
+        if (p.day >= 0 && p.room >= 0) roomOwner[p.room * cells + p.day * numSlots + p.slot] = e;
+    }
+    auto place = [&](int e, const Placement& p) {
+        placements[e] = p;
+        applyToOccupancy(occupancy, e, p, 1);
+        roomOwner[p.room * cells + p.day * numSlots + p.slot] = e;
+    };
+
+    // Bounds the eviction search per entry (each attempt is one placeEntry scan)
+    const int kMaxEvictions = 256;
+    for (int e : leftovers) {
+        Placement p;
+        if (placeEntry(e, view, false, p)) {
+            place(e, p);
+            continue;
+        }
+
+        // Take a free cell of the entry's teacher and groups whose room holds a single class
+        // that fits somewhere else
+        int t = entryTeacher_[e];
+        int evictions = 0;
+        bool placed = false;
+        for (int d = 0; d < (int)workDays_.size() && !placed && evictions < kMaxEvictions; ++d) {
+            for (int s = 0; s < numSlots && !placed && evictions < kMaxEvictions; ++s) {
+                int offset = d * numSlots + s;
+                if (t != -1 && (fastTeacherAvail_[t * cells + offset] == 3 || occupancy.teacher[t * cells + offset] > 0)) continue;
+                bool free = true;
+                for (int g : entryGroups_[e]) {
+                    if (fastGroupAvail_[g * cells + offset] == 3 || occupancy.group[g * cells + offset] > 0) free = false;
+                }
+                if (!free) continue;
+
+                for (int c : suitableRooms(e)) {
+                    int owner = roomOwner[c * cells + offset];
+                    if (owner < 0 || occupancy.room[c * cells + offset] != 1) continue;
+                    if (++evictions > kMaxEvictions) break;
+
+                    Placement previous = placements[owner];
+                    applyToOccupancy(occupancy, owner, previous, -1);
+                    Placement target;
+                    target.day = d;
+                    target.slot = s;
+                    target.room = c;
+                    applyToOccupancy(occupancy, e, target, 1);
+                    Placement moved;
+                    if (placeEntry(owner, view, false, moved)) {
+                        applyToOccupancy(occupancy, e, target, -1);
+                        place(e, target);
+                        place(owner, moved);
+                        placed = true;
+                        break;
+                    }
+                    applyToOccupancy(occupancy, e, target, -1);
+                    applyToOccupancy(occupancy, owner, previous, 1);
+                }
+            }
+        }
+    }
+}
+
+namespace {
+
+// Parts and chains (and scenarios above them) are nested parallel regions. OpenMP's
+// max-active-levels is process-wide, so it is raised only while solves run and the
+// caller's value is restored when the last overlapping solve ends.
+class NestedParallelism {
+public:
+    explicit NestedParallelism(int levels) {
+        #ifdef _OPENMP
+        std::lock_guard<std::mutex> lock(mutex());
+        if (active()++ == 0) saved() = omp_get_max_active_levels();
+        if (omp_get_max_active_levels() < levels) omp_set_max_active_levels(levels);
+        #endif
+    }
+    ~NestedParallelism() {
+        #ifdef _OPENMP
+        std::lock_guard<std::mutex> lock(mutex());
+        if (--active() == 0) omp_set_max_active_levels(saved());
+        #endif
+    }
+    NestedParallelism(const NestedParallelism&) = delete;
+    NestedParallelism& operator=(const NestedParallelism&) = delete;
+
+private:
+    static std::mutex& mutex() { static std::mutex m; return m; }
+    static int& active() { static int n = 0; return n; }
+    static int& saved() { static int levels = 1; return levels; }
+};
+
+} // namespace
+
+std::vector<ScheduleEntry> Scheduler::solve(SnapshotStream* stream) {
+    NestedParallelism nesting(2);
+    int threads = 1;
+    #ifdef _OPENMP
+    threads = omp_get_max_threads();
+    #endif
+
+    std::vector<Placement> placements = solvePlacements(config_, threads, stream);
+    if (stream) stream->finish(placements, calculateCost(placements));
+    return toSchedule(placements);
+}
+
+std::vector<ScenarioResult> Scheduler::solveScenarios(const std::vector<Config>& scenarios) {
+    int numScenarios = scenarios.size();
+    std::vector<ScenarioResult> results(numScenarios);
+    if (numScenarios == 0) return results;
+
+    // Scenarios share one pool: each gets an equal slice of it, parts and chains nest below
+    NestedParallelism nesting(3);
+    int threads = 1;
+    #ifdef _OPENMP
+    threads = omp_get_max_threads();
+    #endif
+    int outer = std::min(threads, numScenarios);
+    int budget = std::max(1, threads / numScenarios);
+
+    #pragma omp parallel for schedule(dynamic) num_threads(outer)
+    for (int k = 0; k < numScenarios; ++k) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<Placement> placements = solvePlacements(scenarios[k], budget);
+
+        SolveContext ctx;
+        ctx.config = &scenarios[k];
+        ctx.entries.resize(entries_.size());
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            ctx.entries[i] = i;
+            if (placements[i].day < 0) results[k].unscheduled++;
+        }
+        calculateCost(placements, &ctx, &results[k].cost);
+        results[k].schedule = toSchedule(placements);
+        results[k].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return results;
+}
@@ -1,12 +1,20 @@
 #ifndef SCHEDULER_H
 #define SCHEDULER_H
 
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <map>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include "spsc_queue.h"
 #ifdef _OPENMP
 #include <omp.h>
 #endif
@@ -24,6 +32,8 @@ struct AvailabilityGrid {
 };
 
 enum class RuleSeverity { Strict, Strong, Medium, Weak };
+// The cost model evaluates AvoidTime, PreferTime and MaxPerDay, like the TS scheduler;
+// validateConfig() rejects the others
 enum class RuleAction { AvoidTime, PreferTime, MaxPerDay, MinPerDay, AvoidRoom, PreferRoom };
 
 struct RuleCondition {
@@ -35,11 +45,11 @@ struct RuleCondition {
 struct SchedulingRule {
     std::string id;
     std::vector<RuleCondition> conditions;
-    RuleAction action;
-    RuleSeverity severity;
+    RuleAction action = RuleAction::AvoidTime;
+    RuleSeverity severity = RuleSeverity::Strict;
     std::string day; // optional
     std::string timeSlotId; // optional
-    int param; // optional (for MaxPerDay etc)
+    int param = 0; // optional (for MaxPerDay etc)
 };
 
 struct Teacher {
@@ -103,16 +113,263 @@ struct ScheduleEntry {
 };
 
 struct Settings {
-    bool allowWindows;
-    bool enforceStandardRules;
-    bool respectProductionCalendar;
-    bool useShortenedPreHolidaySchedule;
+    bool allowWindows = false;
+    bool enforceStandardRules = false;
+    bool respectProductionCalendar = false;
+    bool useShortenedPreHolidaySchedule = false;
+};
+
+enum class LnsAcceptance { Annealing, RecordToRecord };
+
+struct LnsSettings {
+    bool enabled = false;
+    int iterations = 200;           // destroy/repair rounds
+    int parallelRepairs = 4;        // repair attempts per round, run concurrently
+    double destroyFraction = 0.1;   // max share of entries destroyed per attempt
+    LnsAcceptance acceptance = LnsAcceptance::Annealing;
+    double recordDeviation = 0.02;  // record-to-record: allowed relative gap to the best cost
+};
+
+struct DecompositionSettings {
+    bool enabled = false;
+    // Clusters sharing more than this share of the smaller one's rooms are solved together;
+    // less coupled clusters are solved apart on reserved room cells
+    double maxRoomOverlap = 0.5;
 };
 
 struct Config {
-    int strictness;
+    int strictness = 5; // 1-10, as in the scheduler config dialog
     Settings settings;
     std::vector<SchedulingRule> schedulingRules;
+    LnsSettings lns;
+    DecompositionSettings decomposition;
+    double timeLimitSeconds = 0; // search phase budget, 0 = iteration limits only
+    bool enforceLectureOrder = false;
+    bool distributeEvenly = false;
+};
+
+// Checks what parsing alone cannot: false with a message if the config cannot be solved as given
+bool validateConfig(const Config& config, std::string& error);
+
+struct Problem {
+    std::vector<Teacher> teachers;
+    std::vector<Group> groups;
+    std::vector<Classroom> classrooms;
+    std::vector<Subject> subjects;
+    std::vector<TimeSlot> timeSlots;
+    std::vector<UnscheduledEntry> entries;
+};
+
+struct CostBreakdown {
+    double hardConflicts = 0; // double bookings and forbidden cells
+    double availability = 0;
+    double pinnedRooms = 0;
+    double dailyLoad = 0;
+    double distribution = 0;  // weekly distribution terms, see DistributionTracker
+    double rules = 0;         // schedulingRules terms
+    double total = 0;
+};
+
+struct ScenarioResult {
+    std::vector<ScheduleEntry> schedule;
+    CostBreakdown cost;
+    int unscheduled = 0;
+    double seconds = 0;
+};
+
+// Compact position of one entry: indices into days/timeSlots/classrooms, -1 if unplaced
+struct Placement {
+    int day = -1;
+    int slot = -1;
+    int room = -1;
+};
+
+// One published solution of a streaming solve, as changes against the previously published one
+struct SnapshotDiff {
+    int version = 0;                   // 1, 2, ...; diff N applies on top of diff N-1
+    double cost = 0;                   // solver objective, summed over the solved parts
+    bool final = false;                // the finished solution, nothing follows
+    std::vector<int> entries;          // moved entry indices
+    std::vector<Placement> placements; // their new cells
+};
+
+// Read-only array that owns its elements or points into memory kept alive by `owner`
+// (a mapped snapshot, see problem_snapshot.h). Copies share the elements.
+template <typename T>
+class SharedArray {
+public:
+    SharedArray() = default;
+    explicit SharedArray(std::vector<T> values) {
+        auto owned = std::make_shared<const std::vector<T>>(std::move(values));
+        data_ = owned->data();
+        size_ = owned->size();
+        owner_ = std::move(owned);
+    }
+    SharedArray(std::shared_ptr<const void> owner, const T* data, size_t size)
+        : owner_(std::move(owner)), data_(data), size_(size) {}
+
+    const T& operator[](size_t i) const { return data_[i]; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    std::shared_ptr<const void> owner_;
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// One list of IndexLists
+struct IndexRange {
+    const int* first = nullptr;
+    const int* last = nullptr;
+
+    const int* begin() const { return first; }
+    const int* end() const { return last; }
+    size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+    int operator[](size_t i) const { return first[i]; }
+};
+
+// Lists of indices packed CSR style: list i is values[offsets[i], offsets[i + 1])
+class IndexLists {
+public:
+    IndexLists() = default;
+    explicit IndexLists(const std::vector<std::vector<int>>& lists);
+    IndexLists(SharedArray<uint32_t> offsets, SharedArray<int> values)
+        : offsets_(std::move(offsets)), values_(std::move(values)) {}
+
+    IndexRange operator[](size_t i) const { return IndexRange{ values_.begin() + offsets_[i], values_.begin() + offsets_[i + 1] }; }
+    size_t size() const { return offsets_.empty() ? 0 : offsets_.size() - 1; }
+    const SharedArray<uint32_t>& offsets() const { return offsets_; }
+    const SharedArray<int>& values() const { return values_; }
+
+private:
+    SharedArray<uint32_t> offsets_;
+    SharedArray<int> values_;
+};
+
+// Streams improving solutions of a running Scheduler::solve() to one consumer thread.
+// Solver threads offer their best solutions; at most one diff per interval goes into a
+// lock-free SPSC queue (offers are serialized, so there is one producer at a time).
+// While the queue is full nothing is published and the next diff carries all changes.
+// The final diff never waits for the consumer: if the queue is full it is parked aside
+// and pop() returns it after the queued ones.
+class SnapshotStream {
+public:
+    explicit SnapshotStream(double intervalSeconds, size_t capacity = 64);
+
+    // Called on the publishing solver thread after each diff is queued
+    void setNotify(std::function<void()> notify);
+    // Consumer side: diffs in version order, the final one last
+    bool pop(SnapshotDiff& out);
+
+    // Producer side, driven by Scheduler
+    void begin(int numEntries, int numParts);
+    void offer(int part, const std::vector<int>& entries, const std::vector<Placement>& placements, double cost);
+    void finish(const std::vector<Placement>& placements, double cost);
+
+private:
+    SpscQueue<SnapshotDiff> queue_;
+    std::function<void()> notify_;
+    long long intervalNs_;
+    std::atomic<long long> nextDue_{0}; // steady clock, ns
+
+    std::mutex mutex_;
+    std::vector<Placement> current_;   // best offered solution, merged over parts
+    std::vector<Placement> published_; // what the consumer has after the last queued diff
+    std::vector<double> partCost_;
+    int version_ = 0;
+    SnapshotDiff parkedFinal_;              // final diff that did not fit the queue
+    std::atomic<bool> finalParked_{false};
+
+    bool publish(double cost, bool final); // requires mutex_
+};
+
+// Weekly distribution penalties mirroring calculateSlotCost of the TS scheduler:
+// a class of a subject its groups already have that day, lectures after a practice/lab of
+// the same subject that day (lecture order) or of another subject (standard rules), uneven
+// daily load and Saturday classes. As in TS each class is charged once per term however many
+// of its groups see the finding; a repeat is the later class (by slot, then entry index).
+// Backed by per-(group, day) class lists rescanned pairwise on a change, so add/remove of one
+// placement costs O(k^2) per group of the entry, k = that group's classes on the day
+// (at most the slots of a day when conflict-free), independent of the problem size.
+class DistributionTracker {
+public:
+    enum EntryKind { Other = 0, Lecture = 1, Practice = 2 };
+
+    // Static per-problem data, built once by Scheduler::indexify()
+    struct Model {
+        uint64_t id = 0; // unique per indexed problem, lets cached trackers tell models apart
+        int numDays = 0;
+        int numSlots = 0;
+        int numGroups = 0;
+        int saturday = -1;
+        IndexLists entryGroups;                    // [entryIdx] -> group indices
+        std::vector<int> entryKind;                // [entryIdx] -> EntryKind
+        std::vector<int> entrySubject;             // [entryIdx] -> subject index, -1 if unknown
+    };
+
+    DistributionTracker(const Model& model, const Config& config);
+
+    static bool enabled(const Model& model, const Config& config);
+    static uint64_t newModelId();
+
+    const Model& model() const { return *model_; }
+    // Model::id at construction; a model rebuilt in place has another id
+    uint64_t modelId() const { return modelId_; }
+    // Weights of another config over the same model; the placements are kept
+    void setWeights(const Config& config);
+
+    void add(int entryIdx, const Placement& p);
+    void remove(int entryIdx, const Placement& p);
+    double penalty() const;
+
+private:
+    // A class of one group on one day, a node of that group-day's list
+    struct DayClass {
+        int entry;
+        int slot;
+        int subject;
+        int kind;
+        bool repeat;             // an earlier class of its subject is in the list
+        bool afterOwnPractice;   // lecture: a practice of its subject is earlier that day
+        bool afterOtherPractice; // lecture: a practice of another subject is earlier that day
+        int next;                // next node of the list (or of the free list), -1 at the end
+    };
+
+    const Model* model_;
+    uint64_t modelId_;
+    double sameSubjectWeight_;
+    double orderWeight_;
+    double unevenWeight_;
+    double saturdayWeight_;
+    double lectureAfterPracticeWeight_;
+
+    // [group * numDays + day] -> first node of its classes, -1 if none.
+    // Nodes live in one pool, so a reused tracker does not allocate.
+    std::vector<int> groupDayHead_;
+    std::vector<DayClass> nodes_;
+    int freeNode_ = -1;
+    // [entryIdx] -> groups in which the class has the finding
+    std::vector<int> repeatHits_;
+    std::vector<int> ownPracticeHits_;
+    std::vector<int> otherPracticeHits_;
+    // [group * numDays + day] -> classes; [group] -> classes in the week
+    std::vector<int> groupDayLoad_;
+    std::vector<int> groupWeekLoad_;
+
+    long long repeatedSubjects_ = 0;
+    long long orderViolations_ = 0;
+    long long sumSquaredDayLoad_ = 0;
+    long long sumSquaredWeekLoad_ = 0;
+    long long saturdayClasses_ = 0;
+    long long lecturesAfterPractice_ = 0;
+
+    void setFinding(int entryIdx, bool& flag, bool value, std::vector<int>& hits, long long& total);
+    void recountDay(int head);
+    void update(int entryIdx, const Placement& p, int delta);
 };
 
 class Scheduler {
@@ -127,9 +384,26 @@ public:
         const std::vector<UnscheduledEntry>& entries,
         const Config& config
     );
-    std::vector<ScheduleEntry> solve();
+    void loadData(const Problem& problem, const Config& config);
+    // With a stream, improving solutions are published as diffs while solving
+    std::vector<ScheduleEntry> solve(SnapshotStream* stream = nullptr);
+
+    // Solves the loaded problem once per config, concurrently, reusing the same index
+    std::vector<ScenarioResult> solveScenarios(const std::vector<Config>& scenarios);
+
+    // Precompiled index (problem_snapshot.h): save after loadData, load instead of loadData.
+    // sourceHash identifies the source data; a snapshot built from other data is rejected.
+    // The snapshot also keeps the rules of rulesConfig (the loadData config by default) compiled.
+    bool saveSnapshot(const std::string& path, uint64_t sourceHash, std::string& error) const;
+    bool saveSnapshot(const std::string& path, uint64_t sourceHash, const Config& rulesConfig, std::string& error) const;
+    bool loadSnapshot(const std::string& path, uint64_t sourceHash, const Config& config, std::string& error);
 
 private:
+    // Micro-benchmarks (ORBCS/Scheduler/bench) time the private kernels directly,
+    // tests (ORBCS/Scheduler/tests) check the solve stages one by one
+    friend struct SchedulerBench;
+    friend struct SchedulerTest;
+
     std::vector<Teacher> teachers_;
     std::vector<Group> groups_;
     std::vector<Classroom> classrooms_;
@@ -152,23 +426,150 @@ private:
     std::map<std::string, int> tsIdx_; // timeSlot
     std::map<std::string, int> dIdx_; // day
 
-    // Fast Lookups (Vectors of Vectors)
-    // [teacherIdx][dayIdx][slotIdx] -> AvailabilityType
-    std::vector<std::vector<std::vector<int>>> fastTeacherAvail_;
-    // [groupIdx][dayIdx][slotIdx] -> AvailabilityType
-    std::vector<std::vector<std::vector<int>>> fastGroupAvail_;
+    // Fast Lookups. Flat tables and lists are SharedArray / IndexLists, so loadSnapshot()
+    // serves them straight from the mapped file.
+    // [teacherIdx * numDays * numSlots + dayIdx * numSlots + slotIdx] -> AvailabilityType
+    SharedArray<int8_t> fastTeacherAvail_;
+    // [groupIdx * numDays * numSlots + dayIdx * numSlots + slotIdx] -> AvailabilityType
+    SharedArray<int8_t> fastGroupAvail_;
     
     // Pinned rooms: [entityIdx] -> classroomIdx (or -1)
     std::vector<int> fastTeacherPin_;
     std::vector<int> fastGroupPin_;
     std::vector<int> fastSubjectPin_;
 
-    // Pre-calculated suitable classrooms for each subject entry
-    // [entryIdx] -> vector of classroomIndices
-    std::vector<std::vector<int>> entrySuitableRooms_;
+    // Pre-calculated suitable classrooms, shared by entries with the same
+    // (subject, classType, studentCount): [entryIdx] -> signature, [signature] -> classroomIndices
+    std::vector<int> entrySignature_;
+    IndexLists signatureRooms_;
+
+    // Interned ids per entry: [entryIdx] -> teacherIdx / subjectIdx / groupIdxs (-1 if unknown)
+    std::unordered_map<std::string, int> entryIdx_; // uid -> entryIdx
+    std::vector<int> entryTeacher_;
+    std::vector<int> entrySubject_;
+    IndexLists entryGroups_;
+    // [teacherIdx] / [groupIdx] -> entry indices
+    IndexLists teacherEntries_;
+    IndexLists groupEntries_;
+    // [classroomIdx] -> interned room type
+    std::vector<int> classroomType_;
+    int numRoomTypes_ = 0;
+
+    DistributionTracker::Model distributionModel_;
+
+    // One scheduling rule of a config resolved against the index. As in the TS scheduler,
+    // the first condition decides which entries it applies to.
+    struct CompiledRule {
+        RuleAction action = RuleAction::AvoidTime;
+        double penalty = 0;
+        int cell = -1;                      // AvoidTime / PreferTime: day * numSlots + slot
+        int param = 0;                      // MaxPerDay: classes allowed per day and key
+        std::vector<char> applies;          // [entryIdx] -> 1 if the rule applies to the entry
+        IndexLists keys;                    // MaxPerDay: [entryIdx] -> teacher or group indices counted
+    };
+
+    // Rules compiled for the config with hashRules() == snapshotRulesHash_ (problem_snapshot.h), kept by
+    // loadSnapshot() so that solving with that config skips compileRules()
+    std::vector<CompiledRule> snapshotRules_;
+    uint64_t snapshotRulesHash_ = 0;
+    bool hasSnapshotRules_ = false;
+
+    // Usage counters, index = entityIdx * (numDays * numSlots) + dayIdx * numSlots + slotIdx
+    struct Occupancy {
+        std::vector<int> teacher;
+        std::vector<int> group;
+        std::vector<int> room;
+    };
+
+    // Day loads, MaxPerDay counts and room type loads of the accepted LNS solution, kept up
+    // to date on accept so a repair attempt is scored from its own changes only
+    struct LnsTotals {
+        std::vector<int> teacherDayLoad; // [teacher * numDays + day]
+        std::vector<int> groupDayLoad;   // [group * numDays + day]
+        std::vector<int> ruleDayCount;   // [(rule * numKeys + key) * numDays + day], empty without MaxPerDay
+        std::vector<int> roomTypeLoad;   // [roomType] -> placed entries
+    };
+
+    // Read-only base occupancy plus a sparse private delta (copy-on-write view)
+    struct OccupancyView {
+        const Occupancy* base = nullptr;
+        std::unordered_map<int, int> teacher;
+        std::unordered_map<int, int> group;
+        std::unordered_map<int, int> room;
+
+        int teacherAt(int cell) const;
+        int groupAt(int cell) const;
+        int roomAt(int cell) const;
+    };
+
+    // One independently solved part of the problem
+    struct SolveContext {
+        std::vector<int> entries;       // entry indices solved here
+        std::vector<int> reservedRooms; // room cells owned by other parts (room * cells + offset), empty if none
+        std::vector<char> sharedRooms;  // [room] -> 1 if other parts may use it too, empty if none
+        int threads = 1;
+        const Config* config = nullptr;
+        const std::vector<CompiledRule>* rules = nullptr; // compiled config rules, nullptr = compile per call
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+        int part = 0;                   // index among the contexts of one solve
+        SnapshotStream* stream = nullptr;
+    };
 
     void indexify();
+    std::vector<CompiledRule> compileRules(const Config& config) const;
+    // The snapshot's rules when they were compiled for this config, else compiled into `scratch`
+    const std::vector<CompiledRule>& rulesFor(const Config& config, std::vector<CompiledRule>& scratch) const;
+    IndexRange suitableRooms(int entryIdx) const { return signatureRooms_[entrySignature_[entryIdx]]; }
     double calculateCost(const std::vector<ScheduleEntry>& schedule);
+    // Terms of one placed entry that do not depend on other entries: availability, pins and
+    // time rules. Added to `cost` by category when given.
+    double entryTerms(int entryIdx, const Placement& p, double penaltyMultiplier,
+                      const std::vector<CompiledRule>* rules, CostBreakdown* cost) const;
+    // With a tracker its (incrementally maintained) distribution penalty is used as is
+    double calculateCost(const std::vector<Placement>& placements, const SolveContext* ctx = nullptr,
+                         CostBreakdown* breakdown = nullptr, const DistributionTracker* tracker = nullptr);
+
+    std::vector<Placement> toPlacements(const std::vector<ScheduleEntry>& schedule) const;
+    std::vector<ScheduleEntry> toSchedule(const std::vector<Placement>& placements) const;
+    Occupancy buildOccupancy(const std::vector<Placement>& placements, const SolveContext& ctx) const;
+    void applyToOccupancy(Occupancy& occupancy, int entryIdx, const Placement& p, int delta) const;
+    void applyToView(OccupancyView& view, int entryIdx, const Placement& p, int delta) const;
+
+    // Constructive placer: cheapest cell for one entry given the current occupancy.
+    // With allowConflicts the least-conflicting cell is taken when no free one exists.
+    // Shared rooms ([room] -> 1) are taken last, so their free cells can go to other parts.
+    bool placeEntry(int entryIdx, const OccupancyView& view, bool allowConflicts, Placement& out,
+                    const std::vector<char>* sharedRooms = nullptr) const;
+
+    // --- Large Neighborhood Search ---
+    enum class Neighborhood { GroupDay, Teacher, RoomType, Conflict };
+    // placed: placed entries of the context; typeSaturation: [roomType] -> share of its cells in use
+    std::vector<int> selectNeighborhood(Neighborhood kind, const std::vector<Placement>& placements,
+                                        const Occupancy& occupancy, const std::vector<int>& placed,
+                                        const std::vector<double>& typeSaturation,
+                                        int maxDestroy, std::mt19937& rng) const;
+    double lnsObjective(const std::vector<Placement>& placements, const SolveContext& ctx);
+    void applyToTotals(LnsTotals& totals, int entryIdx, const Placement& p, int delta,
+                       const std::vector<CompiledRule>& rules) const;
+    // lnsObjective change of moving `entries` from `current` to `placements`, read from the
+    // occupancy delta recorded in `view`; the tracker must hold `current` and is restored
+    double repairDelta(const std::vector<int>& entries, const std::vector<Placement>& placements,
+                       const std::vector<Placement>& current, const OccupancyView& view,
+                       const LnsTotals& totals, const SolveContext& ctx,
+                       const std::vector<CompiledRule>& rules, DistributionTracker* tracker) const;
+    std::vector<Placement> runLns(const std::vector<Placement>& initial, const SolveContext& ctx);
+
+    std::vector<Placement> runAnnealing(const std::vector<Placement>& initial, const SolveContext& ctx);
+
+    // --- Decomposition ---
+    // Splits entries into parts linked only through rooms, packs them into at most
+    // `threads` contexts and reserves shared room cells between them
+    std::vector<SolveContext> decompose(const Config& config, int threads);
+    // Second pass over a merged decomposed solution: places entries their part could not fit,
+    // using room cells other parts reserved but left free (moving one occupant if needed)
+    void placeLeftovers(std::vector<Placement>& placements) const;
+    std::vector<Placement> solveContext(const SolveContext& ctx);
+    std::vector<Placement> solvePlacements(const Config& config, int threads, SnapshotStream* stream = nullptr);
     // double calculateEntryCost(const ScheduleEntry& entry, const std::vector<ScheduleEntry>& currentSchedule); // Removed unused
 };
 
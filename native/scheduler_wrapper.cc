@@ -1,5 +1,9 @@
 #include <napi.h>
+#include <memory>
+#include <thread>
 #include "scheduler.h"
+#include "problem_buffer.h"
+#include "problem_snapshot.h"
 
 // Helper to get string property
 std::string GetString(const Napi::Object& obj, const char* key) {
@@ -17,6 +21,14 @@ int GetInt(const Napi::Object& obj, const char* key) {
     return 0;
 }
 
+// Helper to get double property
+double GetDouble(const Napi::Object& obj, const char* key, double fallback) {
+    if (obj.Has(key) && obj.Get(key).IsNumber()) {
+        return obj.Get(key).As<Napi::Number>().DoubleValue();
+    }
+    return fallback;
+}
+
 // Helper to get boolean property
 bool GetBool(const Napi::Object& obj, const char* key) {
     if (obj.Has(key) && obj.Get(key).IsBoolean()) {
@@ -60,18 +72,11 @@ AvailabilityGrid GetAvailabilityGrid(const Napi::Object& obj, const char* key) {
     return grid;
 }
 
-Napi::Value RunScheduler(const Napi::CallbackInfo& info) {
-    Napi::Env env = info.Env();
-
-    if (info.Length() < 1 || !info[0].IsObject()) {
-        Napi::TypeError::New(env, "Expected configuration object").ThrowAsJavaScriptException();
-        return env.Null();
-    }
-
-    Napi::Object input = info[0].As<Napi::Object>();
+// Parse problem data (everything except the config)
+Problem ParseProblem(const Napi::Object& input) {
+    Problem problem;
 
     // Parse Teachers
-    std::vector<Teacher> teachers;
     if (input.Has("teachers") && input.Get("teachers").IsArray()) {
         Napi::Array arr = input.Get("teachers").As<Napi::Array>();
         for (uint32_t i = 0; i < arr.Length(); i++) {
@@ -81,12 +86,11 @@ Napi::Value RunScheduler(const Napi::CallbackInfo& info) {
             t.name = GetString(obj, "name");
             t.pinnedClassroomId = GetString(obj, "pinnedClassroomId");
             t.availabilityGrid = GetAvailabilityGrid(obj, "availabilityGrid");
-            teachers.push_back(t);
+            problem.teachers.push_back(t);
         }
     }
 
     // Parse Groups
-    std::vector<Group> groups;
     if (input.Has("groups") && input.Get("groups").IsArray()) {
         Napi::Array arr = input.Get("groups").As<Napi::Array>();
         for (uint32_t i = 0; i < arr.Length(); i++) {
@@ -98,12 +102,11 @@ Napi::Value RunScheduler(const Napi::CallbackInfo& info) {
             g.course = GetInt(obj, "course");
             g.pinnedClassroomId = GetString(obj, "pinnedClassroomId");
             g.availabilityGrid = GetAvailabilityGrid(obj, "availabilityGrid");
-            groups.push_back(g);
+            problem.groups.push_back(g);
         }
     }
 
     // Parse Classrooms
-    std::vector<Classroom> classrooms;
     if (input.Has("classrooms") && input.Get("classrooms").IsArray()) {
         Napi::Array arr = input.Get("classrooms").As<Napi::Array>();
         for (uint32_t i = 0; i < arr.Length(); i++) {
@@ -114,12 +117,11 @@ Napi::Value RunScheduler(const Napi::CallbackInfo& info) {
             c.capacity = GetInt(obj, "capacity");
             c.typeId = GetString(obj, "typeId");
             c.tagIds = GetStringArray(obj, "tagIds");
-            classrooms.push_back(c);
+            problem.classrooms.push_back(c);
         }
     }
 
     // Parse Subjects
-    std::vector<Subject> subjects;
     if (input.Has("subjects") && input.Get("subjects").IsArray()) {
         Napi::Array arr = input.Get("subjects").As<Napi::Array>();
         for (uint32_t i = 0; i < arr.Length(); i++) {
@@ -138,12 +140,11 @@ Napi::Value RunScheduler(const Napi::CallbackInfo& info) {
                     s.classroomTypeRequirements[classType] = GetStringArray(reqs, classType.c_str());
                 }
             }
-            subjects.push_back(s);
+            problem.subjects.push_back(s);
         }
     }
 
     // Parse TimeSlots
-    std::vector<TimeSlot> timeSlots;
     if (input.Has("timeSlots") && input.Get("timeSlots").IsArray()) {
         Napi::Array arr = input.Get("timeSlots").As<Napi::Array>();
         for (uint32_t i = 0; i < arr.Length(); i++) {
@@ -152,12 +153,11 @@ Napi::Value RunScheduler(const Napi::CallbackInfo& info) {
             ts.id = GetString(obj, "id");
             ts.name = GetString(obj, "name");
             ts.order = GetInt(obj, "order");
-            timeSlots.push_back(ts);
+            problem.timeSlots.push_back(ts);
         }
     }
 
     // Parse UnscheduledEntries
-    std::vector<UnscheduledEntry> entries;
     if (input.Has("entries") && input.Get("entries").IsArray()) {
         Napi::Array arr = input.Get("entries").As<Napi::Array>();
         for (uint32_t i = 0; i < arr.Length(); i++) {
@@ -172,57 +172,80 @@ Napi::Value RunScheduler(const Napi::CallbackInfo& info) {
             if (e.groupIds.empty() && obj.Has("groupId")) {
                 e.groupIds.push_back(GetString(obj, "groupId"));
             }
-            entries.push_back(e);
+            problem.entries.push_back(e);
         }
     }
 
-    // Parse Config
+    return problem;
+}
+
+// Parse scheduler config
+Config ParseConfig(const Napi::Object& confObj) {
     Config config;
-    if (input.Has("config") && input.Get("config").IsObject()) {
-        Napi::Object confObj = input.Get("config").As<Napi::Object>();
-        config.strictness = GetInt(confObj, "strictness");
-        
-        if (confObj.Has("settings") && confObj.Get("settings").IsObject()) {
-            Napi::Object setObj = confObj.Get("settings").As<Napi::Object>();
-            config.settings.allowWindows = GetBool(setObj, "allowWindows");
-            config.settings.enforceStandardRules = GetBool(setObj, "enforceStandardRules");
-            config.settings.respectProductionCalendar = GetBool(setObj, "respectProductionCalendar");
-            config.settings.useShortenedPreHolidaySchedule = GetBool(setObj, "useShortenedPreHolidaySchedule");
-        }
-
-        if (confObj.Has("schedulingRules") && confObj.Get("schedulingRules").IsArray()) {
-            Napi::Array rulesArr = confObj.Get("schedulingRules").As<Napi::Array>();
-            for (uint32_t i = 0; i < rulesArr.Length(); i++) {
-                Napi::Object ruleObj = rulesArr.Get(i).As<Napi::Object>();
-                SchedulingRule rule;
-                rule.id = GetString(ruleObj, "id");
-                rule.action = static_cast<RuleAction>(GetInt(ruleObj, "action")); // Assuming enum maps to int
-                rule.severity = static_cast<RuleSeverity>(GetInt(ruleObj, "severity"));
-                rule.day = GetString(ruleObj, "day");
-                rule.timeSlotId = GetString(ruleObj, "timeSlotId");
-                rule.param = GetInt(ruleObj, "param");
-
-                if (ruleObj.Has("conditions") && ruleObj.Get("conditions").IsArray()) {
-                    Napi::Array condArr = ruleObj.Get("conditions").As<Napi::Array>();
-                    for (uint32_t j = 0; j < condArr.Length(); j++) {
-                        Napi::Object condObj = condArr.Get(j).As<Napi::Object>();
-                        RuleCondition cond;
-                        cond.entityType = GetString(condObj, "entityType");
-                        cond.entityIds = GetStringArray(condObj, "entityIds");
-                        cond.classType = GetString(condObj, "classType");
-                        rule.conditions.push_back(cond);
-                    }
+    config.strictness = GetInt(confObj, "strictness");
+    config.timeLimitSeconds = GetDouble(confObj, "timeLimitSeconds", 0);
+    config.enforceLectureOrder = GetBool(confObj, "enforceLectureOrder");
+    config.distributeEvenly = GetBool(confObj, "distributeEvenly");
+    
+    if (confObj.Has("settings") && confObj.Get("settings").IsObject()) {
+        Napi::Object setObj = confObj.Get("settings").As<Napi::Object>();
+        config.settings.allowWindows = GetBool(setObj, "allowWindows");
+        config.settings.enforceStandardRules = GetBool(setObj, "enforceStandardRules");
+        config.settings.respectProductionCalendar = GetBool(setObj, "respectProductionCalendar");
+        config.settings.useShortenedPreHolidaySchedule = GetBool(setObj, "useShortenedPreHolidaySchedule");
+    }
+
+    if (confObj.Has("schedulingRules") && confObj.Get("schedulingRules").IsArray()) {
+        Napi::Array rulesArr = confObj.Get("schedulingRules").As<Napi::Array>();
+        for (uint32_t i = 0; i < rulesArr.Length(); i++) {
+            Napi::Object ruleObj = rulesArr.Get(i).As<Napi::Object>();
+            SchedulingRule rule;
+            rule.id = GetString(ruleObj, "id");
+            // Numeric RuleAction / RuleSeverity values, mapped from the TS enums by nativeScheduler.ts
+            rule.action = static_cast<RuleAction>(GetInt(ruleObj, "action"));
+            rule.severity = static_cast<RuleSeverity>(GetInt(ruleObj, "severity"));
+            rule.day = GetString(ruleObj, "day");
+            rule.timeSlotId = GetString(ruleObj, "timeSlotId");
+            rule.param = GetInt(ruleObj, "param");
+
+            if (ruleObj.Has("conditions") && ruleObj.Get("conditions").IsArray()) {
+                Napi::Array condArr = ruleObj.Get("conditions").As<Napi::Array>();
+                for (uint32_t j = 0; j < condArr.Length(); j++) {
+                    Napi::Object condObj = condArr.Get(j).As<Napi::Object>();
+                    RuleCondition cond;
+                    cond.entityType = GetString(condObj, "entityType");
+                    cond.entityIds = GetStringArray(condObj, "entityIds");
+                    cond.classType = GetString(condObj, "classType");
+                    rule.conditions.push_back(cond);
                 }
-                config.schedulingRules.push_back(rule);
             }
+            config.schedulingRules.push_back(rule);
         }
     }
 
-    Scheduler scheduler;
-    scheduler.loadData(teachers, groups, classrooms, subjects, timeSlots, entries, config);
-    std::vector<ScheduleEntry> result = scheduler.solve();
+    if (confObj.Has("lns") && confObj.Get("lns").IsObject()) {
+        Napi::Object lnsObj = confObj.Get("lns").As<Napi::Object>();
+        config.lns.enabled = GetBool(lnsObj, "enabled");
+        if (lnsObj.Has("iterations")) config.lns.iterations = GetInt(lnsObj, "iterations");
+        if (lnsObj.Has("parallelRepairs")) config.lns.parallelRepairs = GetInt(lnsObj, "parallelRepairs");
+        config.lns.destroyFraction = GetDouble(lnsObj, "destroyFraction", config.lns.destroyFraction);
+        config.lns.recordDeviation = GetDouble(lnsObj, "recordDeviation", config.lns.recordDeviation);
+        if (GetString(lnsObj, "acceptance") == "recordToRecord") {
+            config.lns.acceptance = LnsAcceptance::RecordToRecord;
+        }
+    }
+
+    if (confObj.Has("decomposition") && confObj.Get("decomposition").IsObject()) {
+        Napi::Object decObj = confObj.Get("decomposition").As<Napi::Object>();
+        if (decObj.Has("enabled")) config.decomposition.enabled = GetBool(decObj, "enabled");
+        config.decomposition.maxRoomOverlap = GetDouble(decObj, "maxRoomOverlap", config.decomposition.maxRoomOverlap);
+    }
 
-    // Convert result back to JS
+    return config;
+}
+
+// Convert result back to JS
+Napi::Array ScheduleToJs(Napi::Env env, const std::vector<ScheduleEntry>& result) {
     Napi::Array output = Napi::Array::New(env, result.size());
     for (size_t i = 0; i < result.size(); i++) {
         Napi::Object item = Napi::Object::New(env);
@@ -247,8 +270,270 @@ Napi::Value RunScheduler(const Napi::CallbackInfo& info) {
     return output;
 }
 
+Napi::Value RunScheduler(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Expected configuration object").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    Napi::Object input = info[0].As<Napi::Object>();
+    Problem problem = ParseProblem(input);
+
+    Config config;
+    if (input.Has("config") && input.Get("config").IsObject()) {
+        config = ParseConfig(input.Get("config").As<Napi::Object>());
+    }
+    std::string error;
+    if (!validateConfig(config, error)) {
+        Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    Scheduler scheduler;
+    scheduler.loadData(problem, config);
+    std::vector<ScheduleEntry> result = scheduler.solve();
+
+    return ScheduleToJs(env, result);
+}
+
+// Solves the scenarios of runSchedulerBatch on a libuv worker thread
+class BatchWorker : public Napi::AsyncWorker {
+public:
+    BatchWorker(Napi::Env env, Problem problem, std::vector<Config> scenarios, std::string snapshotPath)
+        : Napi::AsyncWorker(env), deferred_(Napi::Promise::Deferred::New(env)),
+          problem_(std::move(problem)), scenarios_(std::move(scenarios)), snapshotPath_(std::move(snapshotPath)) {}
+
+    Napi::Promise Promise() { return deferred_.Promise(); }
+
+protected:
+    void Execute() override {
+        try {
+            Config first = scenarios_.empty() ? Config() : scenarios_[0];
+            std::string error;
+            if (snapshotPath_.empty()) {
+                scheduler_.loadData(problem_, first);
+            } else {
+                // The snapshot is keyed by the problem buffer of the C ABI; a missing or stale
+                // one is rebuilt for the next run, and failing to write it only costs that reuse
+                std::vector<uint8_t> buffer = encodeProblem(problem_);
+                uint64_t sourceHash = hashProblemBuffer(buffer.data(), buffer.size());
+                if (!scheduler_.loadSnapshot(snapshotPath_, sourceHash, first, error)) {
+                    scheduler_.loadData(problem_, first);
+                    scheduler_.saveSnapshot(snapshotPath_, sourceHash, error);
+                }
+            }
+            results_ = scheduler_.solveScenarios(scenarios_);
+        } catch (const std::exception& e) {
+            SetError(e.what());
+        }
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::Array output = Napi::Array::New(env, results_.size());
+        for (size_t i = 0; i < results_.size(); i++) {
+            Napi::Object cost = Napi::Object::New(env);
+            cost.Set("hardConflicts", results_[i].cost.hardConflicts);
+            cost.Set("availability", results_[i].cost.availability);
+            cost.Set("pinnedRooms", results_[i].cost.pinnedRooms);
+            cost.Set("dailyLoad", results_[i].cost.dailyLoad);
+            cost.Set("distribution", results_[i].cost.distribution);
+            cost.Set("rules", results_[i].cost.rules);
+            cost.Set("total", results_[i].cost.total);
+
+            Napi::Object item = Napi::Object::New(env);
+            item.Set("schedule", ScheduleToJs(env, results_[i].schedule));
+            item.Set("cost", cost);
+            item.Set("unscheduled", results_[i].unscheduled);
+            item.Set("seconds", results_[i].seconds);
+            output[i] = item;
+        }
+        deferred_.Resolve(output);
+    }
+
+    void OnError(const Napi::Error& error) override {
+        deferred_.Reject(error.Value());
+    }
+
+private:
+    Napi::Promise::Deferred deferred_;
+    Problem problem_;
+    std::vector<Config> scenarios_;
+    std::string snapshotPath_;
+    Scheduler scheduler_;
+    std::vector<ScenarioResult> results_;
+};
+
+// runSchedulerBatch(input, configs[], options?): one problem, many configs solved concurrently off
+// the JS thread. Resolves with [{ schedule, cost, unscheduled, seconds }] in config order.
+// options.snapshotPath names a precompiled snapshot (problem_snapshot.h) used instead of indexing
+// the problem, and written when it is missing or stale; the rules of the first config are kept in it.
+Napi::Value RunSchedulerBatch(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsObject() || !info[1].IsArray()) {
+        Napi::TypeError::New(env, "Expected problem object and array of configs").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    Problem problem = ParseProblem(info[0].As<Napi::Object>());
+
+    std::vector<Config> scenarios;
+    Napi::Array confArr = info[1].As<Napi::Array>();
+    for (uint32_t i = 0; i < confArr.Length(); i++) {
+        if (!confArr.Get(i).IsObject()) {
+            Napi::TypeError::New(env, "Expected config object").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        scenarios.push_back(ParseConfig(confArr.Get(i).As<Napi::Object>()));
+        std::string error;
+        if (!validateConfig(scenarios.back(), error)) {
+            Napi::TypeError::New(env, "config " + std::to_string(i) + ": " + error).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    std::string snapshotPath;
+    if (info.Length() > 2 && info[2].IsObject()) {
+        Napi::Object options = info[2].As<Napi::Object>();
+        if (options.Has("snapshotPath") && options.Get("snapshotPath").IsString()) {
+            snapshotPath = options.Get("snapshotPath").As<Napi::String>().Utf8Value();
+        }
+    }
+
+    BatchWorker* worker = new BatchWorker(env, std::move(problem), std::move(scenarios), std::move(snapshotPath));
+    Napi::Promise promise = worker->Promise();
+    worker->Queue();
+    return promise;
+}
+
+// State of one streaming run, shared by the solver thread and the JS thread
+struct StreamingRun {
+    Scheduler scheduler;
+    std::unique_ptr<SnapshotStream> stream;
+    Napi::ThreadSafeFunction onSnapshot;
+    Napi::Promise::Deferred deferred;
+    std::thread worker;
+    int version = 0;
+    double cost = 0;
+    int scheduled = 0;
+    int unscheduled = 0;
+    bool failed = false;
+    std::string error; // what the solver thread threw, if failed
+
+    explicit StreamingRun(Napi::Env env) : deferred(Napi::Promise::Deferred::New(env)) {}
+};
+
+// Delivers every queued diff as { version, cost, final, entries: Int32Array, cells: Int32Array }.
+// cells holds day, timeSlot and classroom indices (-1 if unplaced) for each moved entry.
+void DrainSnapshots(Napi::Env env, Napi::Function callback, StreamingRun* run) {
+    SnapshotDiff diff;
+    while (run->stream->pop(diff)) {
+        size_t count = diff.entries.size();
+        Napi::Int32Array entries = Napi::Int32Array::New(env, count);
+        Napi::Int32Array cells = Napi::Int32Array::New(env, count * 3);
+        for (size_t i = 0; i < count; i++) {
+            entries[i] = diff.entries[i];
+            cells[i * 3] = diff.placements[i].day;
+            cells[i * 3 + 1] = diff.placements[i].slot;
+            cells[i * 3 + 2] = diff.placements[i].room;
+        }
+        if (diff.final) {
+            run->version = diff.version;
+            run->cost = diff.cost;
+        }
+
+        Napi::Object snapshot = Napi::Object::New(env);
+        snapshot.Set("version", diff.version);
+        snapshot.Set("cost", diff.cost);
+        snapshot.Set("final", diff.final);
+        snapshot.Set("entries", entries);
+        snapshot.Set("cells", cells);
+        callback.Call({ snapshot });
+    }
+}
+
+// runSchedulerStreaming(input, onSnapshot): solves on a background thread and reports improving
+// solutions as diffs (see DrainSnapshots). Resolves with { version, cost, scheduled, unscheduled }
+// once the final diff has been delivered and rejects if the solver throws;
+// input.config.snapshotIntervalMs sets the pace (250 ms).
+Napi::Value RunSchedulerStreaming(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsObject() || !info[1].IsFunction()) {
+        Napi::TypeError::New(env, "Expected configuration object and snapshot callback").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    Napi::Object input = info[0].As<Napi::Object>();
+    auto problem = std::make_shared<Problem>(ParseProblem(input));
+
+    Config config;
+    double intervalMs = 250;
+    if (input.Has("config") && input.Get("config").IsObject()) {
+        Napi::Object confObj = input.Get("config").As<Napi::Object>();
+        config = ParseConfig(confObj);
+        intervalMs = GetDouble(confObj, "snapshotIntervalMs", intervalMs);
+    }
+    std::string error;
+    if (!validateConfig(config, error)) {
+        Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    StreamingRun* run = new StreamingRun(env);
+    run->stream.reset(new SnapshotStream(intervalMs / 1000.0));
+    run->onSnapshot = Napi::ThreadSafeFunction::New(
+        env, info[1].As<Napi::Function>(), "schedulerSnapshots", 0, 1, run,
+        [](Napi::Env env, StreamingRun* run) {
+            // All queued snapshot calls have run by now
+            run->worker.join();
+            if (run->failed) {
+                run->deferred.Reject(Napi::Error::New(env, run->error).Value());
+                delete run;
+                return;
+            }
+            Napi::Object summary = Napi::Object::New(env);
+            summary.Set("version", run->version);
+            summary.Set("cost", run->cost);
+            summary.Set("scheduled", run->scheduled);
+            summary.Set("unscheduled", run->unscheduled);
+            run->deferred.Resolve(summary);
+            delete run;
+        });
+
+    run->stream->setNotify([run]() {
+        run->onSnapshot.NonBlockingCall([run](Napi::Env env, Napi::Function callback) {
+            DrainSnapshots(env, callback, run);
+        });
+    });
+
+    Napi::Promise promise = run->deferred.Promise();
+    run->worker = std::thread([run, problem, config]() {
+        // Nothing may escape the thread; the finalizer rejects the promise instead
+        try {
+            run->scheduler.loadData(*problem, config);
+            std::vector<ScheduleEntry> result = run->scheduler.solve(run->stream.get());
+            run->scheduled = result.size();
+            run->unscheduled = problem->entries.size() - result.size();
+        } catch (const std::exception& e) {
+            run->failed = true;
+            run->error = e.what();
+        } catch (...) {
+            run->failed = true;
+            run->error = "Native scheduler failed";
+        }
+        run->onSnapshot.Release();
+    });
+    return promise;
+}
+
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
     exports.Set(Napi::String::New(env, "runScheduler"), Napi::Function::New(env, RunScheduler));
+    exports.Set(Napi::String::New(env, "runSchedulerBatch"), Napi::Function::New(env, RunSchedulerBatch));
+    exports.Set(Napi::String::New(env, "runSchedulerStreaming"), Napi::Function::New(env, RunSchedulerStreaming));
     return exports;
 }
 
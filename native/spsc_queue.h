@@ -0,0 +1,40 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free single-producer/single-consumer ring buffer.
+// push() is only called from the producer side, pop() only from the consumer side.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) : slots_(capacity + 1) {}
+
+    // False if the queue is full; the value is left untouched then
+    bool push(T& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t next = (tail + 1) % slots_.size();
+        if (next == head_.load(std::memory_order_acquire)) return false;
+        slots_[tail] = std::move(value);
+        tail_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& out) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+        out = std::move(slots_[head]);
+        head_.store((head + 1) % slots_.size(), std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> slots_;
+    alignas(64) std::atomic<size_t> head_{0}; // next slot to read, owned by the consumer
+    alignas(64) std::atomic<size_t> tail_{0}; // next slot to write, owned by the producer
+};
+
+#endif // SPSC_QUEUE_H
@@ -165,7 +165,12 @@ const generateClassPool = (data: GenerationData): UnscheduledEntry[] => {
 };
 
 
-export const generateScheduleWithHeuristics = async (data: GenerationData, config: HeuristicConfig): Promise<SchedulerResult> => {
+// onDraft, when given, receives intermediate drafts from the streaming native scheduler
+export const generateScheduleWithHeuristics = async (
+    data: GenerationData,
+    config: HeuristicConfig,
+    onDraft?: (draft: ScheduleEntry[]) => void
+): Promise<SchedulerResult> => {
 
     // Check for native scheduler availability
     // We import dynamically to avoid issues if the module is not built
@@ -178,15 +183,30 @@ export const generateScheduleWithHeuristics = async (data: GenerationData, confi
         console.log("Using Native C++ Scheduler...");
         try {
             const classPool = generateClassPool(data);
-            const nativeSchedule = await nativeService.generateScheduleWithNative(
-                data.teachers,
-                data.groups,
-                data.classrooms,
-                data.subjects,
-                data.timeSlots,
-                classPool,
-                config
-            );
+            const nativeSchedule = onDraft
+                ? await nativeService.generateScheduleStreamingWithNative(
+                    data.teachers,
+                    data.groups,
+                    data.classrooms,
+                    data.subjects,
+                    data.timeSlots,
+                    classPool,
+                    config,
+                    data.settings,
+                    data.schedulingRules,
+                    (draft: ScheduleEntry[]) => onDraft(draft)
+                )
+                : await nativeService.generateScheduleWithNative(
+                    data.teachers,
+                    data.groups,
+                    data.classrooms,
+                    data.subjects,
+                    data.timeSlots,
+                    classPool,
+                    config,
+                    data.settings,
+                    data.schedulingRules
+                );
 
             // Native scheduler returns placed entries. We need to calculate unschedulable.
             const placedUids = new Set(nativeSchedule.map((e: any) => e.unscheduledUid));
@@ -1,6 +1,8 @@
 import {
-    ScheduleEntry, Teacher, Group, Classroom, Subject, TimeSlot, UnscheduledEntry, HeuristicConfig
+    ScheduleEntry, Teacher, Group, Classroom, Subject, TimeSlot, UnscheduledEntry, HeuristicConfig, SchedulingRule,
+    SchedulingSettings, RuleAction, RuleSeverity
 } from '../types';
+import { DAYS_OF_WEEK } from '../constants';
 
 // Try to load the native module
 let nativeScheduler: any = null;
@@ -16,6 +18,88 @@ export const isNativeSchedulerAvailable = () => {
     return !!nativeScheduler;
 };
 
+// Prepare data for C++
+// We pass only the necessary fields to minimize overhead
+const buildNativeProblem = (
+    teachers: Teacher[],
+    groups: Group[],
+    classrooms: Classroom[],
+    subjects: Subject[],
+    timeSlots: TimeSlot[],
+    entries: UnscheduledEntry[]
+) => ({
+    teachers: teachers.map(t => ({ id: t.id })),
+    groups: groups.map(g => ({ id: g.id, studentCount: g.studentCount })),
+    classrooms: classrooms.map(c => ({
+        id: c.id,
+        capacity: c.capacity,
+        typeId: c.typeId,
+        tagIds: c.tagIds || []
+    })),
+    subjects: subjects.map(s => ({
+        id: s.id,
+        classroomTypeRequirements: s.classroomTypeRequirements || {}
+    })),
+    timeSlots: timeSlots.map(ts => ({ id: ts.id, time: ts.time })),
+    entries: entries.map(e => ({
+        uid: e.uid,
+        subjectId: e.subjectId,
+        teacherId: e.teacherId,
+        classType: e.classType,
+        studentCount: e.studentCount,
+        groupIds: e.groupIds || (e.groupId ? [e.groupId] : []),
+        groupId: e.groupId // Fallback
+    }))
+});
+
+// Native RuleAction / RuleSeverity values (native/scheduler.h). The native cost model evaluates
+// the same actions as calculateSlotCost of the JS scheduler; rules of other actions are ignored there
+// too and are not sent.
+const NATIVE_RULE_ACTIONS: Partial<Record<RuleAction, number>> = {
+    [RuleAction.AvoidTime]: 0,
+    [RuleAction.PreferTime]: 1,
+    [RuleAction.MaxPerDay]: 2,
+};
+const NATIVE_RULE_SEVERITIES: Record<RuleSeverity, number> = {
+    [RuleSeverity.Strict]: 0,
+    [RuleSeverity.Strong]: 1,
+    [RuleSeverity.Medium]: 2,
+    [RuleSeverity.Weak]: 3,
+};
+
+const buildNativeRules = (rules: SchedulingRule[] = []) => rules
+    .filter(rule => NATIVE_RULE_ACTIONS[rule.action] !== undefined)
+    // A MaxPerDay rule without a limit is skipped by the JS scheduler as well
+    .filter(rule => rule.action !== RuleAction.MaxPerDay || rule.param !== undefined)
+    .map(rule => ({
+        id: rule.id,
+        action: NATIVE_RULE_ACTIONS[rule.action],
+        severity: NATIVE_RULE_SEVERITIES[rule.severity],
+        day: rule.day,
+        timeSlotId: rule.timeSlotId,
+        param: rule.param ?? 0,
+        conditions: rule.conditions.map(c => ({
+            entityType: c.entityType,
+            entityIds: c.entityIds,
+            classType: c.classType
+        }))
+    }));
+
+// Every entry point sends the rules, so one config costs the same however it is solved
+const buildNativeConfig = (config: HeuristicConfig, settings?: SchedulingSettings, schedulingRules?: SchedulingRule[]) => ({
+    strictness: config.strictness,
+    enforceLectureOrder: config.enforceLectureOrder,
+    distributeEvenly: config.distributeEvenly,
+    settings: settings && {
+        allowWindows: settings.allowWindows,
+        enforceStandardRules: settings.enforceStandardRules
+    },
+    lns: config.lns,
+    decomposition: config.decomposition,
+    snapshotIntervalMs: config.snapshotIntervalMs,
+    schedulingRules: buildNativeRules(schedulingRules)
+});
+
 export const generateScheduleWithNative = async (
     teachers: Teacher[],
     groups: Group[],
@@ -23,7 +107,9 @@ export const generateScheduleWithNative = async (
     subjects: Subject[],
     timeSlots: TimeSlot[],
     entries: UnscheduledEntry[],
-    config: HeuristicConfig
+    config: HeuristicConfig,
+    settings?: SchedulingSettings,
+    schedulingRules?: SchedulingRule[]
 ): Promise<ScheduleEntry[]> => {
     if (!nativeScheduler) {
         throw new Error("Native scheduler is not available.");
@@ -32,34 +118,9 @@ export const generateScheduleWithNative = async (
     console.log("Starting native scheduler...");
     const start = performance.now();
 
-    // Prepare data for C++
-    // We pass only the necessary fields to minimize overhead
     const input = {
-        teachers: teachers.map(t => ({ id: t.id })),
-        groups: groups.map(g => ({ id: g.id, studentCount: g.studentCount })),
-        classrooms: classrooms.map(c => ({
-            id: c.id,
-            capacity: c.capacity,
-            typeId: c.typeId,
-            tagIds: c.tagIds || []
-        })),
-        subjects: subjects.map(s => ({
-            id: s.id,
-            classroomTypeRequirements: s.classroomTypeRequirements || {}
-        })),
-        timeSlots: timeSlots.map(ts => ({ id: ts.id, time: ts.time })),
-        entries: entries.map(e => ({
-            uid: e.uid,
-            subjectId: e.subjectId,
-            teacherId: e.teacherId,
-            classType: e.classType,
-            studentCount: e.studentCount,
-            groupIds: e.groupIds || (e.groupId ? [e.groupId] : []),
-            groupId: e.groupId // Fallback
-        })),
-        config: {
-            strictness: config.strictness
-        }
+        ...buildNativeProblem(teachers, groups, classrooms, subjects, timeSlots, entries),
+        config: buildNativeConfig(config, settings, schedulingRules)
     };
 
     const result = nativeScheduler.runScheduler(input);
@@ -69,3 +130,121 @@ export const generateScheduleWithNative = async (
 
     return result as ScheduleEntry[];
 };
+
+// Diff against the previous snapshot: cells holds [dayIdx, timeSlotIdx, classroomIdx] per moved entry
+// (indices into DAYS_OF_WEEK, timeSlots and classrooms; -1 when the entry is unplaced)
+interface NativeSnapshot {
+    version: number;
+    cost: number;
+    final: boolean;
+    entries: Int32Array;
+    cells: Int32Array;
+}
+
+// Same as generateScheduleWithNative, but onDraft receives improving drafts while the solver runs.
+// Only moved entries cross the native boundary; the draft is rebuilt here from the diffs.
+export const generateScheduleStreamingWithNative = async (
+    teachers: Teacher[],
+    groups: Group[],
+    classrooms: Classroom[],
+    subjects: Subject[],
+    timeSlots: TimeSlot[],
+    entries: UnscheduledEntry[],
+    config: HeuristicConfig,
+    settings: SchedulingSettings | undefined,
+    schedulingRules: SchedulingRule[] | undefined,
+    onDraft: (draft: ScheduleEntry[], cost: number) => void
+): Promise<ScheduleEntry[]> => {
+    if (!nativeScheduler) {
+        throw new Error("Native scheduler is not available.");
+    }
+
+    const start = performance.now();
+    const input = {
+        ...buildNativeProblem(teachers, groups, classrooms, subjects, timeSlots, entries),
+        config: buildNativeConfig(config, settings, schedulingRules)
+    };
+
+    const placed = new Map<number, ScheduleEntry>();
+    const onSnapshot = (snapshot: NativeSnapshot) => {
+        for (let i = 0; i < snapshot.entries.length; i++) {
+            const entryIdx = snapshot.entries[i];
+            const day = snapshot.cells[i * 3];
+            if (day < 0) {
+                placed.delete(entryIdx);
+                continue;
+            }
+            const entry = entries[entryIdx];
+            const room = snapshot.cells[i * 3 + 2];
+            placed.set(entryIdx, {
+                id: `sched-${entry.uid}`,
+                day: DAYS_OF_WEEK[day],
+                timeSlotId: timeSlots[snapshot.cells[i * 3 + 1]].id,
+                classroomId: room >= 0 ? classrooms[room].id : '',
+                subjectId: entry.subjectId,
+                teacherId: entry.teacherId,
+                classType: entry.classType,
+                unscheduledUid: entry.uid,
+                groupIds: entry.groupIds || (entry.groupId ? [entry.groupId] : [])
+            } as ScheduleEntry);
+        }
+        if (!snapshot.final) onDraft(Array.from(placed.values()), snapshot.cost);
+    };
+
+    const summary = await nativeScheduler.runSchedulerStreaming(input, onSnapshot);
+
+    const end = performance.now();
+    console.log(`Native scheduler streamed ${summary.version} snapshots in ${(end - start).toFixed(2)}ms. Generated ${summary.scheduled} entries.`);
+
+    // Entry order, as in the non-streaming result
+    return Array.from(placed.entries()).sort((a, b) => a[0] - b[0]).map(([, entry]) => entry);
+};
+
+export interface NativeScenario {
+    config: HeuristicConfig;
+    settings?: SchedulingSettings;
+    schedulingRules?: SchedulingRule[];
+    timeLimitSeconds?: number;
+}
+
+export interface NativeScenarioResult {
+    schedule: ScheduleEntry[];
+    cost: {
+        hardConflicts: number; availability: number; pinnedRooms: number; dailyLoad: number; distribution: number;
+        rules: number; total: number
+    };
+    unscheduled: number;
+    seconds: number;
+}
+
+// Solves several variants of the same problem in one native call: the problem is indexed once
+// and the variants run concurrently on a worker thread. With snapshotPath the index is read from
+// that precompiled snapshot file, and the file is (re)written when missing or built from other data.
+export const generateScenariosWithNative = async (
+    teachers: Teacher[],
+    groups: Group[],
+    classrooms: Classroom[],
+    subjects: Subject[],
+    timeSlots: TimeSlot[],
+    entries: UnscheduledEntry[],
+    scenarios: NativeScenario[],
+    snapshotPath?: string
+): Promise<NativeScenarioResult[]> => {
+    if (!nativeScheduler) {
+        throw new Error("Native scheduler is not available.");
+    }
+
+    const start = performance.now();
+    const problem = buildNativeProblem(teachers, groups, classrooms, subjects, timeSlots, entries);
+    const configs = scenarios.map(s => ({
+        ...buildNativeConfig(s.config, s.settings, s.schedulingRules),
+        timeLimitSeconds: s.timeLimitSeconds
+    }));
+
+    const results = await nativeScheduler.runSchedulerBatch(problem, configs, { snapshotPath });
+
+    const end = performance.now();
+    console.log(`Native scheduler solved ${results.length} scenarios in ${(end - start).toFixed(2)}ms.`);
+
+    return results as NativeScenarioResult[];
+};
@@ -288,6 +288,25 @@ export interface HeuristicConfig {
   iterations: number;
   enforceLectureOrder: boolean;
   distributeEvenly: boolean;
+  lns?: NativeLnsConfig;
+  decomposition?: NativeDecompositionConfig;
+  snapshotIntervalMs?: number; // native streaming: minimal pause between draft snapshots
+}
+
+// Large Neighborhood Search mode of the native scheduler (replaces simulated annealing when enabled)
+export interface NativeLnsConfig {
+  enabled: boolean;
+  iterations?: number;
+  parallelRepairs?: number;
+  destroyFraction?: number;
+  acceptance?: 'annealing' | 'recordToRecord';
+  recordDeviation?: number;
+}
+
+// Splitting of the native problem into parts solved concurrently (off by default)
+export interface NativeDecompositionConfig {
+  enabled: boolean;
+  maxRoomOverlap?: number;
 }
 
 export interface SessionSchedulerConfig {